@@ -0,0 +1,232 @@
+// Probe counts of the variable hash table before and after it became a
+// swiss table over interned symbols. The old table is reproduced here:
+// 128 byte inline keys, quadratic probing over prime capacities taken from
+// a counter shared by every table.
+//
+// Build with `make bench`.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/arena.h"
+#include "../src/hashtable.h"
+
+// the library expects these from the program, as glorp.c defines them
+arena a;
+const char *program_name = "symtab";
+
+#define OLD_KEY_MAX 128
+#define OLD_MAX_LOAD_FACTOR 0.7
+
+typedef struct {
+    char key[OLD_KEY_MAX];
+    size_t key_length;
+    size_t scope;
+    object_slot value;
+    bool is_const;
+} old_item;
+
+typedef struct {
+    size_t size;
+    size_t capacity;
+    size_t removed;
+    old_item *values;
+
+    size_t lookups;
+    size_t probes;  // slots looked at by lookups
+} old_table;
+
+static const size_t primes[] = {53,     97,     193,    389,     769,     1543,    3079,
+                                6151,   12289,  24593,  49157,   98317,   196613,  393241,
+                                786433, 1572869, 3145739, 6291469, 12582917, 25165843};
+
+static size_t cur_prime = 0;
+
+static void old_alloc(old_table *t) {
+    t->capacity = primes[cur_prime++];
+    t->values = (old_item *)calloc(t->capacity, sizeof(old_item));
+}
+
+static size_t old_hash(const char *key, size_t key_length, size_t scope) {
+    size_t h1 = 5381;
+    for (size_t i = 0; i < key_length; ++i)
+        h1 = ((h1 << 5) + h1) ^ (size_t)key[i];
+    size_t h2 = scope * 11400714819323198485llu;
+    return h1 ^ (h2 + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
+}
+
+static bool old_find(old_table *t, const char *key, size_t key_length, size_t scope,
+                     size_t *idx) {
+    size_t hash = old_hash(key, key_length, scope);
+    ++t->lookups;
+
+    for (size_t i = 0;; ++i) {
+        ++t->probes;
+        *idx = (hash + i * i) % t->capacity;
+        old_item *cur = t->values + *idx;
+
+        if (cur->key[0] == 0)
+            return false;
+        if (cur->key_length == key_length && strncmp(cur->key, key, key_length) == 0 &&
+            cur->scope == scope)
+            return true;
+    }
+}
+
+static void old_set(old_table *t, const old_item *item);
+
+static void old_resize(old_table *t) {
+    old_item *old = t->values;
+    size_t old_capacity = t->capacity;
+
+    old_alloc(t);
+    t->size = 0;
+    t->removed = 0;
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old[i].key[0] > 1)
+            old_set(t, old + i);
+    }
+    free(old);
+}
+
+static void old_set(old_table *t, const old_item *item) {
+    size_t idx;
+    if (old_find(t, item->key, item->key_length, item->scope, &idx))
+        return;
+
+    size_t hash = old_hash(item->key, item->key_length, item->scope);
+    for (size_t i = 0;; ++i) {
+        idx = (hash + i * i) % t->capacity;
+        if (t->values[idx].key[0] <= 1)
+            break;
+    }
+
+    if (t->values[idx].key[0] == 1)
+        --t->removed;
+    t->values[idx] = *item;
+    ++t->size;
+
+    if ((double)(t->size + t->removed) / (double)t->capacity > OLD_MAX_LOAD_FACTOR)
+        old_resize(t);
+}
+
+static void old_remove(old_table *t, const char *key, size_t key_length, size_t scope) {
+    size_t idx;
+    if (!old_find(t, key, key_length, scope, &idx))
+        return;
+    t->values[idx].key[0] = 1;
+    --t->size;
+    ++t->removed;
+}
+
+#define GLOBALS 1000
+#define FRAMES 200000
+#define FRAME_VARS 8
+#define NAMES (GLOBALS + FRAME_VARS)
+
+static char names[NAMES][16];
+static size_t lengths[NAMES];
+static const symbol *symbols[NAMES];
+
+typedef struct {
+    size_t lookups;
+    size_t probes;
+    double seconds;
+} result;
+
+// every global is defined, then looked up once present and once with a
+// scope it is not in. Then each frame binds, reads and removes a handful
+// of locals under a fresh scope
+static result run_old(void) {
+    old_table t = {0};
+    old_alloc(&t);
+    old_item item = {0};
+    size_t idx;
+
+    clock_t start = clock();
+
+    for (size_t i = 0; i < GLOBALS; ++i) {
+        memcpy(item.key, names[i], lengths[i]);
+        item.key_length = lengths[i];
+        item.scope = 0;
+        old_set(&t, &item);
+    }
+    for (size_t i = 0; i < GLOBALS; ++i) {
+        old_find(&t, names[i], lengths[i], 0, &idx);
+        old_find(&t, names[i], lengths[i], 1, &idx);
+    }
+
+    for (size_t scope = 1; scope <= FRAMES; ++scope) {
+        for (size_t i = GLOBALS; i < NAMES; ++i) {
+            memset(item.key, 0, sizeof(item.key));
+            memcpy(item.key, names[i], lengths[i]);
+            item.key_length = lengths[i];
+            item.scope = scope;
+            old_set(&t, &item);
+        }
+        for (size_t i = GLOBALS; i < NAMES; ++i)
+            old_find(&t, names[i], lengths[i], scope, &idx);
+        for (size_t i = GLOBALS; i < NAMES; ++i)
+            old_remove(&t, names[i], lengths[i], scope);
+    }
+
+    result r = {t.lookups, t.probes, (double)(clock() - start) / CLOCKS_PER_SEC};
+    free(t.values);
+    return r;
+}
+
+static result run_new(void) {
+    hash_table ht;
+    ht_init(&ht);
+    table_item item = {0};
+
+    clock_t start = clock();
+
+    for (size_t i = 0; i < GLOBALS; ++i) {
+        item.key = symbols[i];
+        item.scope = 0;
+        ht_set(&ht, &item);
+    }
+    for (size_t i = 0; i < GLOBALS; ++i) {
+        ht_get(&ht, symbols[i], 0, NULL, NULL);
+        ht_get(&ht, symbols[i], 1, NULL, NULL);
+    }
+
+    for (size_t scope = 1; scope <= FRAMES; ++scope) {
+        for (size_t i = GLOBALS; i < NAMES; ++i) {
+            item.key = symbols[i];
+            item.scope = scope;
+            ht_set(&ht, &item);
+        }
+        for (size_t i = GLOBALS; i < NAMES; ++i)
+            ht_get(&ht, symbols[i], scope, NULL, NULL);
+        for (size_t i = GLOBALS; i < NAMES; ++i)
+            ht_remove(&ht, symbols[i], scope);
+    }
+
+    result r = {ht.items.lookups, ht.items.probes, (double)(clock() - start) / CLOCKS_PER_SEC};
+    ht_destroy(&ht);
+    return r;
+}
+
+// a probe is one item for the old table and a group of control bytes for
+// the new one
+static void report(const char *name, result r, size_t item_size) {
+    printf("%-6s item: %3zu bytes  lookups: %8zu  probes/lookup: %5.2f  time: %.3fs\n", name,
+           item_size, r.lookups, (double)r.probes / (double)r.lookups, r.seconds);
+}
+
+int main(void) {
+    for (size_t i = 0; i < NAMES; ++i) {
+        lengths[i] = (size_t)snprintf(names[i], sizeof(names[i]), "var_%zu", i);
+        symbols[i] = intern(names[i], lengths[i]);
+    }
+
+    report("before", run_old(), sizeof(old_item));
+    report("after", run_new(), sizeof(table_item));
+
+    symbols_destroy();
+    return 0;
+}
@@ -83,6 +83,35 @@ typedef struct {
 
 typedef struct expr_list expr_list;
 typedef struct expr expr;
+typedef struct chunk chunk;
+
+typedef struct {
+    uint64_t hash;
+    size_t length;
+    char literal[];
+} symbol;
+
+typedef struct frame_layout frame_layout;
+
+typedef struct {
+    uint32_t slot;
+    bool outer;
+} capture_source;
+
+struct frame_layout {
+    const symbol **vars;
+    size_t size;
+    size_t capacity;
+
+    bool escapes;
+
+    struct object *free_frames;
+    size_t free_count;
+
+    bool flat;
+    frame_layout *captures;
+    capture_source *capture_from;
+};
 
 struct expr_list {
     expr *head;
@@ -114,9 +143,19 @@ typedef enum {
 
     EXPR_TYPE_IMPORT_EXPRESSION,
 
+    EXPR_TYPE_ARGUMENT,
+
     EXPR_ENUM_LENGTH,
 } expr_type;
 
+typedef enum {
+    QUICK_UNSEEN,
+    QUICK_INT,
+    QUICK_FLOAT,
+    QUICK_CLOSURE,
+    QUICK_GENERIC,
+} quick_kind;
+
 struct expr {
     token start_tok;
     token end_tok;
@@ -124,6 +163,9 @@ struct expr {
     expr *next;  // only used in expression list
 
     expr_type type;
+    quick_kind quick;
+
+    struct object *constant;
     union {
         // program
         // list literal
@@ -136,6 +178,12 @@ struct expr {
         struct {
             const char *literal;
             size_t length;
+
+            const symbol *sym;
+
+            const frame_layout *layout;
+            uint32_t depth;
+            uint32_t slot;
         };
 
         // char literal
@@ -147,6 +195,9 @@ struct expr {
         // float literal
         double float_value;
 
+        // argument
+        struct object *value;
+
         // prefix
         // assign
         // infix
@@ -154,6 +205,9 @@ struct expr {
             token op;
             expr *right;
             expr *left;
+
+            frame_layout *fn_layout;
+            chunk *fn_code;
         };
 
         // ternary
@@ -167,6 +221,11 @@ struct expr {
         struct {
             expr *function;
             expr_list params;
+
+            const frame_layout *known_layout;
+            const expr *known_params;
+
+            bool is_tail_call;
         };
 
         // index
@@ -185,11 +244,20 @@ struct expr {
 
 typedef struct environment environment;
 typedef struct object_list object_list;
+
+#define SLOT_SIZE 24
+
+typedef struct {
+    _Alignas(8) unsigned char bytes[SLOT_SIZE];
+} object_slot;
+
+#define STRING_SMALL_CAPACITY 16
+
 typedef struct object object;
 
 struct object_list {
-    object *head;
-    object *tail;
+    object *store;
+    size_t offset;
     size_t size;
 };
 
@@ -208,19 +276,30 @@ typedef enum {
     OBJECT_TYPE_LVALUE,
 
     // doesn't get evaluated
-    OBJECT_TYPE_LIST_NODE,
+    OBJECT_TYPE_LIST_STORE,
+    OBJECT_TYPE_STRING_STORE,
     OBJECT_TYPE_ENVIRONMENT,
+    OBJECT_TYPE_CELL,
 
     OBJECT_TYPE_ENUM_LENGTH,
 } object_type;
 
 
+typedef enum {
+    FUNCTION_KIND_NORMAL,
+    FUNCTION_KIND_BUILTIN,
+    FUNCTION_KIND_BOUND,     // callee with its first argument bound
+    FUNCTION_KIND_COMPOSED,  // callee applied to the result of inner
+} function_kind;
+
 typedef bool builtin_fn_t(const expr_list *params, const expr *call, environment *env, object *result);
 
 struct object {
     size_t rc;
 
     object_type type;
+    uint8_t color;  // gc_color of heap objects, see gc.h
+    bool buffered;  // among the possible roots of the cycle collector
     union {
         // char
         char char_value;
@@ -233,12 +312,14 @@ struct object {
 
         // function
         struct {
-            bool builtin;
+            function_kind kind;
             union {
                 // normal functions
                 struct {
                     expr_list params;
                     const expr *body;
+                    frame_layout *layout;
+                    const chunk *code;
                 };
 
                 // builtin functions
@@ -246,6 +327,15 @@ struct object {
                     size_t builtin_param_count;
                     builtin_fn_t *builtin_fn;
                 };
+
+                // bound and composed functions, neither has an outer_env
+                struct {
+                    object_slot callee;
+                    union {
+                        object_slot bound_arg;
+                        object_slot inner;
+                    };
+                };
             };
 
             environment *outer_env;
@@ -257,23 +347,39 @@ struct object {
         // lvalue
         object *ref;  // reference to heap allocated object
 
-        // list node
+        // list and string stores
         struct {
-            object *value;
-            object *next;
+            union {
+                object_slot *items;
+                char *bytes;
+            };
+            size_t lo;
+            size_t hi;
+            size_t capacity;
+            char small[STRING_SMALL_CAPACITY];
         };
 
         // environment
         // environment env;
+
+        // cell
+        // env_binding cell;
     };
 };
 
 typedef struct {
     object *obj;
-    object *ln;
+    object_slot *slot;
+    object_slot *end;
 } ol_iterator;
 
-void ol_append(object_list *ol, object *obj);
+object *slot_obj(object_slot *slot);
+void slot_store(object_slot *slot, const object *value);
+
+void ol_append(object_list *ol, const object_slot *slot);
+void ol_init_str(object_list *ol, const char *str, size_t length);
+void ol_ref(const object_list *ol, size_t idx, object *result);
+const char *ol_str(const object_list *ol);
 ol_iterator ol_start(const object_list *ol);
 
 void oli_next(ol_iterator *oli);
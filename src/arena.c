@@ -1,5 +1,10 @@
 #include "arena.h"
 
+#include <stddef.h>
+#include <string.h>
+
+#include "gc.h"
+
 extern arena a;
 //
 // clang-format off
@@ -20,31 +25,85 @@ static const char *const expression_type_literals[EXPR_ENUM_LENGTH] = {
     [EXPR_TYPE_INDEX_EXPRESSION]   = "INDEX EXPRESSION",
     [EXPR_TYPE_CASE_EXPRESSION]    = "CASE EXPRESSION",
     [EXPR_TYPE_IMPORT_EXPRESSION]  = "IMPORT EXPRESSION",
+    [EXPR_TYPE_ARGUMENT]           = "ARGUMENT",
 };
 // clang-format on
 
 // clang-format off
 static const char *const object_type_literals[OBJECT_TYPE_ENUM_LENGTH] = {
-    [OBJECT_TYPE_NULL]        = "NULL", 
-    [OBJECT_TYPE_UNIT]        = "UNIT",
-    [OBJECT_TYPE_CHAR]        = "CHAR",
-    [OBJECT_TYPE_INT]         = "INT", 
-    [OBJECT_TYPE_FLOAT]       = "FLOAT",
-    [OBJECT_TYPE_FUNCTION]    = "FUNCTION", 
-    [OBJECT_TYPE_LIST]        = "LIST", 
-    [OBJECT_TYPE_LIST_NODE]   = "LIST NODE",
-    [OBJECT_TYPE_ENVIRONMENT] = "ENVIRONMENT",
+    [OBJECT_TYPE_NULL]         = "NULL",
+    [OBJECT_TYPE_UNIT]         = "UNIT",
+    [OBJECT_TYPE_CHAR]         = "CHAR",
+    [OBJECT_TYPE_INT]          = "INT",
+    [OBJECT_TYPE_FLOAT]        = "FLOAT",
+    [OBJECT_TYPE_FUNCTION]     = "FUNCTION",
+    [OBJECT_TYPE_LIST]         = "LIST",
+    [OBJECT_TYPE_LIST_STORE]   = "LIST STORE",
+    [OBJECT_TYPE_STRING_STORE] = "STRING STORE",
+    [OBJECT_TYPE_ENVIRONMENT]  = "ENVIRONMENT",
+    [OBJECT_TYPE_CELL]         = "CELL",
+};
+// clang-format on
+
+// end of the union member a slab's objects need, the rest is never touched
+#define OBJ_END(field) (offsetof(object, field) + sizeof(((object *)0)->field))
+
+// clang-format off
+static const size_t obj_slab_sizes[OBJ_SLAB_COUNT] = {
+    [OBJ_SLAB_LIST]         = OBJ_END(values),
+    [OBJ_SLAB_LIST_STORE]   = OBJ_END(capacity),
+    [OBJ_SLAB_STRING_STORE] = OBJ_END(small),
+    [OBJ_SLAB_FUNCTION]     = OBJ_END(outer_env),
+    [OBJ_SLAB_ENVIRONMENT]  = OBJ_END(env),
+    [OBJ_SLAB_CELL]         = OBJ_END(cell),
+};
+
+static const char *const obj_slab_literals[OBJ_SLAB_COUNT] = {
+    [OBJ_SLAB_LIST]         = "LIST",
+    [OBJ_SLAB_LIST_STORE]   = "LIST STORE",
+    [OBJ_SLAB_STRING_STORE] = "STRING STORE",
+    [OBJ_SLAB_FUNCTION]     = "FUNCTION",
+    [OBJ_SLAB_ENVIRONMENT]  = "ENVIRONMENT",
+    [OBJ_SLAB_CELL]         = "CELL",
+};
+
+static const obj_slab obj_slabs[OBJECT_TYPE_ENUM_LENGTH] = {
+    [OBJECT_TYPE_FUNCTION]     = OBJ_SLAB_FUNCTION,
+    [OBJECT_TYPE_LIST]         = OBJ_SLAB_LIST,
+    [OBJECT_TYPE_LIST_STORE]   = OBJ_SLAB_LIST_STORE,
+    [OBJECT_TYPE_STRING_STORE] = OBJ_SLAB_STRING_STORE,
+    [OBJECT_TYPE_ENVIRONMENT]  = OBJ_SLAB_ENVIRONMENT,
+    [OBJECT_TYPE_CELL]         = OBJ_SLAB_CELL,
 };
 // clang-format on
 
+static inline fixed_alloc *slab_alloc(object_type type) {
+    assert(type != OBJECT_TYPE_LVALUE && !is_inline_type(type));
+    return &a.obj_allocs[obj_slabs[type]];
+}
+
 void arena_init(arena *a) {
+    *a = (arena){0};
+
     ba_init(&a->expr_alloc);
-    fa_init(&a->obj_alloc, sizeof(object));
+    for (size_t i = 0; i < OBJ_SLAB_COUNT; ++i)
+        fa_init(&a->obj_allocs[i], obj_slab_sizes[i]);
 }
 
 void arena_destroy(arena *a) {
+    for (size_t i = 0; i < a->constant_count; ++i) {
+        a->constants[i]->rc = 1;
+        rc_dec(a->constants[i]);
+    }
+
+    // the slabs go at once, but not the item buffers of what is still dead
+    free_dead(0);
+    gc_destroy();
+    free(a->dead);
+    free(a->constants);
     ba_destroy(&a->expr_alloc);
-    fa_destroy(&a->obj_alloc);
+    for (size_t i = 0; i < OBJ_SLAB_COUNT; ++i)
+        fa_destroy(&a->obj_allocs[i]);
 }
 
 expr *new_expr(expr_type type, const token *tok) {
@@ -87,61 +146,210 @@ void free_last_expr(void) {
 }
 
 object *new_obj(object_type type, size_t rc) {
-    object *obj = (object *)fa_malloc(&a.obj_alloc);
-    *obj = (object){
-        .rc = rc,
-        .type = type,
-    };
+    ++gc_allocated;
 
-    return obj;
-}
+    if (a.dead_count > 0)
+        free_dead(a.free_budget);
+
+    object *obj = (object *)fa_malloc(slab_alloc(type));
+    memset(obj, 0, obj_size(type));
 
-object *new_empty_obj(void) {
-    return (object *)fa_malloc(&a.obj_alloc);
+    obj->rc = rc;
+    obj->type = type;
+
+    return obj;
 }
 
 object *new_copied_obj(const object *o) {
-    object *r = (object *)fa_malloc(&a.obj_alloc);
-    *r = *o;
+    ++gc_allocated;
+
+    if (a.dead_count > 0)
+        free_dead(a.free_budget);
+
+    object *r = (object *)fa_malloc(slab_alloc(o->type));
+    copy_obj(r, o);
+    r->color = GC_BLACK;
+    r->buffered = false;
     return r;
 }
 
-void free_obj(object *obj) { fa_free(&a.obj_alloc, obj); }
+void free_obj(object *obj) { fa_free(slab_alloc(obj->type), obj); }
 
-void cleanup(object *o) {
+void make_constant(object *o) {
+    if (a.constant_count == a.constant_capacity) {
+        a.constant_capacity = a.constant_capacity ? 2 * a.constant_capacity : 64;
+        a.constants = (object **)realloc(a.constants, a.constant_capacity * sizeof(object *));
+
+        if (a.constants == NULL) {
+            fprintf(stderr, "Error malloc constants");
+            exit(1);
+        }
+    }
+
+    o->rc = OBJECT_RC_IMMORTAL;
+    a.constants[a.constant_count++] = o;
+}
+
+size_t obj_size(object_type type) {
+    // lvalues only ever live on the stack
+    if (type == OBJECT_TYPE_LVALUE)
+        return sizeof(object);
+    if (is_inline_type(type))
+        return SLOT_SIZE;
+    return obj_slab_sizes[obj_slabs[type]];
+}
+
+// heap objects are only as large as their slab, so they must never be
+// copied with a plain struct assignment
+void copy_obj(object *dst, const object *src) {
+    memcpy(dst, src, obj_size(src->type));
+}
+
+bool is_heap_obj(const object *o) {
+    if (o->type == OBJECT_TYPE_LVALUE || is_inline_type(o->type))
+        return false;
+    return fa_valid_ptr(slab_alloc(o->type), (void *)o);
+}
+
+// drops what the function o refers to
+static void release_function(object *o) {
+    switch (o->kind) {
+        case FUNCTION_KIND_NORMAL: {
+            if (o->outer_env->obj != NULL)
+                rc_dec(o->outer_env->obj);
+        } break;
+        case FUNCTION_KIND_BOUND:
+        case FUNCTION_KIND_COMPOSED: {
+            slot_release(&o->callee);
+            slot_release(&o->inner);
+        } break;
+        default: {
+        }
+    }
+}
+
+void release_obj(object *o) {
     switch (o->type) {
         case OBJECT_TYPE_LIST: {
-            rc_dec(o->values.head);
+            rc_dec(o->values.store);
         } break;
-        case OBJECT_TYPE_LIST_NODE: {
-            rc_dec(o->next);
-            rc_dec(o->value);
+        case OBJECT_TYPE_LIST_STORE:
+        case OBJECT_TYPE_STRING_STORE: {
+            release_items(o, o->lo, o->hi);
+            free_items(o);
         } break;
         case OBJECT_TYPE_ENVIRONMENT: {
             env_destroy(&o->env);
         } break;
+        case OBJECT_TYPE_CELL: {
+            if (o->cell.is_bound)
+                slot_release(&o->cell.value);
+        } break;
         case OBJECT_TYPE_FUNCTION: {
-            if (o->outer_env->obj != NULL) {
-                rc_dec(o->outer_env->obj);
-            }
+            release_function(o);
         } break;
         default: {
         }
     }
-    fa_free(&a.obj_alloc, o);
+}
+
+static void destroy(object *o) {
+    // buffered frames are still referenced by the collector's roots
+    if (o->type == OBJECT_TYPE_ENVIRONMENT && !o->buffered && env_pool_frame(o))
+        return;
+
+    release_obj(o);
+
+    // the collector frees it with its roots
+    if (o->buffered) {
+        o->color = GC_BLACK;
+        return;
+    }
+
+    free_obj(o);
+}
+
+void cleanup(object *o) {
+    if (a.dead_count == a.dead_capacity) {
+        a.dead_capacity = a.dead_capacity ? 2 * a.dead_capacity : 256;
+        a.dead = (object **)realloc(a.dead, a.dead_capacity * sizeof(object *));
+
+        if (a.dead == NULL) {
+            fprintf(stderr, "Error malloc dead objects");
+            exit(1);
+        }
+    }
+
+    // kept out of the collector's roots until it is freed
+    o->color = GC_GARBAGE;
+    a.dead[a.dead_count++] = o;
+
+    if (a.free_budget == 0)
+        free_dead(0);
+}
+
+void free_dead(size_t budget) {
+    // objects dying while others are freed are pushed for this loop
+    if (a.freeing)
+        return;
+
+    a.freeing = true;
+
+    for (size_t steps = 0; a.dead_count > 0 && (budget == 0 || steps < budget); ++steps) {
+        object *o = a.dead[a.dead_count - 1];
+
+        // the items released are freed before the rest of the store
+        if (o->type == OBJECT_TYPE_LIST_STORE && o->hi - o->lo > FREE_CHUNK) {
+            release_items(o, o->hi - FREE_CHUNK, o->hi);
+            o->hi -= FREE_CHUNK;
+            continue;
+        }
+
+        --a.dead_count;
+        destroy(o);
+    }
+
+    a.freeing = false;
 }
 
 void temp_cleanup(object *o) {
-    if (fa_valid_ptr(&a.obj_alloc, o))
+    if (is_heap_obj(o))
         return;
 
     switch (o->type) {
         case OBJECT_TYPE_LIST: {
-            rc_dec(o->values.head);
+            rc_dec(o->values.store);
         } break;
         case OBJECT_TYPE_FUNCTION: {
-            if (o->outer_env->obj != NULL)
-                rc_dec(o->outer_env->obj);
+            release_function(o);
+        } break;
+        default: {
+        }
+    }
+}
+
+// makes a stack copy of a heap object own what it references, so it can be
+// released with temp_cleanup like any other temporary
+void temp_retain(object *o) {
+    switch (o->type) {
+        case OBJECT_TYPE_LIST: {
+            if (o->values.store != NULL)
+                ++o->values.store->rc;
+        } break;
+        case OBJECT_TYPE_FUNCTION: {
+            switch (o->kind) {
+                case FUNCTION_KIND_NORMAL: {
+                    if (o->outer_env->obj != NULL)
+                        ++o->outer_env->obj->rc;
+                } break;
+                case FUNCTION_KIND_BOUND:
+                case FUNCTION_KIND_COMPOSED: {
+                    slot_retain(&o->callee);
+                    slot_retain(&o->inner);
+                } break;
+                default: {
+                }
+            }
         } break;
         default: {
         }
@@ -156,6 +364,8 @@ void rc_dec(object *o) {
 
     if (--o->rc == 0) {
         cleanup(o);
+    } else {
+        gc_possible_root(o);
     }
 }
 
@@ -163,7 +373,9 @@ void print_debug_info(void) {
     printf("\n---DEBUG---\n\n");
     /* arena_print_exprs(); */
     /* printf("\n------\n"); */
+    printf("EXPRESSIONS ARENA RECLAIMED: %zu\n\n", a.expr_alloc.reclaimed);
     arena_print_objects();
+    print_gc_info();
 }
 
 void arena_print_exprs(void) {
@@ -173,8 +385,8 @@ void arena_print_exprs(void) {
 
     size_t exprs = size / sizeof(expr);
 
-    printf("EXPRESSIONS ARENA\nEXPRS: %zu\nSIZE: %zu\nCAPACITY: %zu\n",
-           exprs, a.expr_alloc.size, a.expr_alloc.pages * page_size);
+    printf("EXPRESSIONS ARENA\nEXPRS: %zu\nSIZE: %zu\nCAPACITY: %zu\nRECLAIMED: %zu\n",
+           exprs, a.expr_alloc.size, a.expr_alloc.pages * page_size, a.expr_alloc.reclaimed);
 
     printf("\nEXPRESSIONS:\n");
     expr *e;
@@ -186,18 +398,35 @@ void arena_print_exprs(void) {
 
 void arena_print_objects(void) {
     size_t page_size = sysconf(_SC_PAGESIZE);
-    size_t capacity = a.obj_alloc.pages * page_size;
+
+    size_t size = 0, capacity = 0, objects = 0, released = 0, reclaimed = 0;
+    for (size_t i = 0; i < OBJ_SLAB_COUNT; ++i) {
+        const fixed_alloc *fa = &a.obj_allocs[i];
+        size += fa->size;
+        capacity += fa->pages * page_size;
+        objects += fa->size / fa->ty_size;
+        released += fa->released_pages * page_size;
+        reclaimed += fa->reclaimed;
+    }
 
     printf("OBJECTS ARENA\nSIZE: %zu\nCAPACITY: %zu\nOBJECTS: %zu\n",
-           a.obj_alloc.size, capacity, a.obj_alloc.size / a.obj_alloc.ty_size);
+           size, capacity, objects);
+    printf("RELEASED: %zu\nRECLAIMED: %zu\n", released, reclaimed);
 
-    size_t ty_size = a.obj_alloc.ty_size;
+    for (size_t i = 0; i < OBJ_SLAB_COUNT; ++i) {
+        fixed_alloc *fa = &a.obj_allocs[i];
+        size_t slab_capacity = fa->pages * page_size;
 
-    for (size_t i = 0; i < capacity; i += ty_size) {
-        object *o = (object *)(a.obj_alloc.store + i);
-        if (!fa_valid_ptr(&a.obj_alloc, o))
-            continue;
+        printf("\n%s SLAB (%zu bytes)\nSIZE: %zu\nCAPACITY: %zu\nOBJECTS: %zu\n",
+               obj_slab_literals[i], fa->ty_size, fa->size, slab_capacity,
+               fa->size / fa->ty_size);
 
-        printf("%p: type: %-11s, rc: %zu\n", (void *)o, object_type_literals[o->type], o->rc);
+        for (size_t j = 0; j + fa->ty_size <= slab_capacity; j += fa->ty_size) {
+            object *o = (object *)(fa->store + j);
+            if (!fa_valid_ptr(fa, o))
+                continue;
+
+            printf("%p: type: %-11s, rc: %zu\n", (void *)o, object_type_literals[o->type], o->rc);
+        }
     }
 }
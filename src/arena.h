@@ -6,9 +6,49 @@
 #include "fixedalloc.h"
 #include "object.h"
 
+// objects are allocated from a slab sized to their variant of the object
+// union, so a list does not pay for a whole function. Scalars are
+// never allocated, they live in slots (see slot.h)
+typedef enum {
+    OBJ_SLAB_LIST,
+    OBJ_SLAB_LIST_STORE,
+    OBJ_SLAB_STRING_STORE,
+    OBJ_SLAB_FUNCTION,
+    OBJ_SLAB_ENVIRONMENT,
+    OBJ_SLAB_CELL,
+
+    OBJ_SLAB_COUNT,
+} obj_slab;
+
+// steps new_obj takes freeing dead objects when freeing is lazy, a step
+// frees one object or releases up to FREE_CHUNK items of a list store
+#ifndef FREE_BUDGET
+#define FREE_BUDGET 8
+#endif
+
+#ifndef FREE_CHUNK
+#define FREE_CHUNK 64
+#endif
+
+// Objects whose count drops to zero are pushed on `dead` and freed from
+// there, so dropping a deeply nested structure doesn't recurse. They are
+// all freed before rc_dec returns, unless `free_budget` is set: then each
+// allocation takes that many steps and the rest waits for the next ones.
 typedef struct {
     bump_alloc expr_alloc;
-    fixed_alloc obj_alloc;
+    fixed_alloc obj_allocs[OBJ_SLAB_COUNT];
+
+    object **dead;
+    size_t dead_count;
+    size_t dead_capacity;
+    bool freeing;
+
+    size_t free_budget;
+
+    // immortal objects, freed with the arena
+    object **constants;
+    size_t constant_count;
+    size_t constant_capacity;
 } arena;
 
 void arena_init(arena *);
@@ -19,12 +59,24 @@ expr *new_expr2(expr_type, const token *);
 expr *new_expr3(expr_type, const token *start, const token *end);
 
 object *new_obj(object_type, size_t rc);
-object *new_empty_obj(void);
 object *new_copied_obj(const object *);
 void free_obj(object *);
 
+// makes o immortal until the arena is destroyed
+void make_constant(object *);
+
+size_t obj_size(object_type);
+void copy_obj(object *dst, const object *src);
+bool is_heap_obj(const object *);
+
+// drops the references o holds, leaving it allocated
+void release_obj(object *);
 void cleanup(object *);
+
+// frees dead objects in at most budget steps, all of them when 0
+void free_dead(size_t budget);
 void temp_cleanup(object *);
+void temp_retain(object *);
 void rc_dec(object *);
 
 void print_debug_info(void);
@@ -177,6 +177,8 @@ typedef struct {
 
     const char *unknown_option;
 
+    char *inline_value;  // value given as --name=value or -nvalue
+
     int rest_argc;
     char **rest_argv;
 } Argp_Ctx;
@@ -192,6 +194,15 @@ static char *shift_args(void) {
     return res;
 }
 
+// value of the flag being parsed, either inline or the next argument
+static char *flag_value(void) {
+    Argp_Ctx *c = &argp_global_ctx;
+    if (c->inline_value == NULL) return shift_args();
+    char *res = c->inline_value;
+    c->inline_value = NULL;
+    return res;
+}
+
 static Argp_Flag *argp_new_flag(Argp_Type type, const char *short_name, const char *long_name,
                                 const char *meta_var, const char *desc) {
     assert(short_name != NULL || long_name != NULL);
@@ -488,8 +499,21 @@ static Argp_Flag *try_short_name(const char *arg, size_t n) {
     for (size_t i = 0; i < c->flag_count; ++i) {
         Argp_Flag *flag = c->flags + i;
         if (!flag->short_name) continue;
-        if (strcmp(short_name, flag->short_name) == 0)
+        if (strcmp(short_name, flag->short_name) == 0) {
+            c->inline_value = NULL;
+            return flag;
+        }
+    }
+
+    // flags taking a value also accept it attached, as in -O1
+    for (size_t i = 0; i < c->flag_count; ++i) {
+        Argp_Flag *flag = c->flags + i;
+        if (!flag->short_name || flag->type == ARGP_BOOL) continue;
+        size_t name_len = strlen(flag->short_name);
+        if (strncmp(short_name, flag->short_name, name_len) == 0) {
+            c->inline_value = (char *)short_name + name_len;
             return flag;
+        }
     }
 
     return NULL;
@@ -502,11 +526,17 @@ static Argp_Flag *try_long_name(const char *arg, size_t n) {
         return NULL;
     const char *long_name = arg + 2;
 
+    const char *eq = strchr(long_name, '=');
+    size_t name_len = eq ? (size_t)(eq - long_name) : n - 2;
+
     for (size_t i = 0; i < c->flag_count; ++i) {
         Argp_Flag *flag = c->flags + i;
         if (!flag->long_name) continue;
-        if (strcmp(long_name, flag->long_name) == 0)
+        if (strlen(flag->long_name) == name_len &&
+            strncmp(long_name, flag->long_name, name_len) == 0) {
+            c->inline_value = eq ? (char *)eq + 1 : NULL;
             return flag;
+        }
     }
 
     return NULL;
@@ -589,31 +619,32 @@ static bool argp_parse_flag(Argp_Flag *flag) {
     Argp_Ctx *c = &argp_global_ctx;
     switch (flag->type) {
         case ARGP_BOOL: {
+            c->inline_value = NULL;
             flag->val.as_bool = true;
         } break;
         case ARGP_UINT: {
-            char *arg = shift_args();
+            char *arg = flag_value();
             if (!argp_parse_uint(arg, &flag->val.as_uint)) {
                 c->err_flag = flag;
                 return false;
             }
         } break;
         case ARGP_STR: {
-            char *arg = shift_args();
+            char *arg = flag_value();
             if (!argp_parse_str(arg, &flag->val.as_str)) {
                 c->err_flag = flag;
                 return false;
             }
         } break;
         case ARGP_ENUM: {
-            char *arg = shift_args();
+            char *arg = flag_value();
             if (!argp_parse_enum(arg, &flag->val.as_enum, flag->enum_options, flag->option_count)) {
                 c->err_flag = flag;
                 return false;
             }
         } break;
         case ARGP_LIST: {
-            char *arg = shift_args();
+            char *arg = flag_value();
             if (!argp_parse_list_entry(arg, &flag->val.as_list)) {
                 c->err_flag = flag;
                 return false;
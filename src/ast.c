@@ -272,3 +272,24 @@ void el_append(expr_list *el, expr *e) {
     el->tail = e;
     ++el->size;
 }
+
+bool is_method_call(const expr *call_expr) {
+    const expr *callee = call_expr->function;
+    return callee->type == EXPR_TYPE_INFIX_EXPRESSION && callee->op.type == TOKEN_TYPE_DOT;
+}
+
+bool is_constant_list(const expr *list_literal) {
+    for (const expr *e = list_literal->expressions.head; e != NULL; e = e->next) {
+        switch (e->type) {
+            case EXPR_TYPE_UNIT:
+            case EXPR_TYPE_CHAR_LITERAL:
+            case EXPR_TYPE_INT_LITERAL:
+            case EXPR_TYPE_FLOAT_LITERAL:
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return list_literal->expressions.size > 0;
+}
@@ -6,12 +6,44 @@
 #include <stdlib.h>
 
 #include "error.h"
+#include "symbol.h"
 #include "token.h"
 
 #define WARN_UNUSED_RESULT __attribute__((warn_unused_result))
 
 typedef struct expr_list expr_list;
 typedef struct expr expr;
+typedef struct chunk chunk;
+
+typedef struct frame_layout frame_layout;
+
+// where a closure finds a variable it captures when it is made: slot
+// `slot` of the frame making it, or of that frame's captures when `outer`
+typedef struct {
+    uint32_t slot;
+    bool outer;
+} capture_source;
+
+// the variables of a function body in slot order: its parameters followed
+// by everything it assigns to, filled in by the resolver
+struct frame_layout {
+    const symbol **vars;
+    size_t size;
+    size_t capacity;
+
+    bool escapes;  // the body makes closures or imports, which may outlive its frames
+
+    // frames of a layout that doesn't escape, kept for its next calls
+    struct object *free_frames;
+    size_t free_count;
+
+    // A flat function is nested in another and its closures hold only the
+    // variables it uses from the functions around it, laid out by
+    // `captures` (NULL when there are none) and found at `capture_from`
+    bool flat;
+    frame_layout *captures;
+    capture_source *capture_from;
+};
 
 struct expr_list {
     expr *head;
@@ -43,9 +75,22 @@ typedef enum {
 
     EXPR_TYPE_IMPORT_EXPRESSION,
 
+    // an argument evaluated before the call, passed to builtins called by
+    // other builtins. Never parsed
+    EXPR_TYPE_ARGUMENT,
+
     EXPR_ENUM_LENGTH,
 } expr_type;
 
+// what a node has seen of its operands, see quickening in evaluator.c
+typedef enum {
+    QUICK_UNSEEN,
+    QUICK_INT,      // infix, two ints
+    QUICK_FLOAT,    // infix, two floats
+    QUICK_CLOSURE,  // call, always the same function
+    QUICK_GENERIC,  // saw something else, stays on the generic path
+} quick_kind;
+
 struct expr {
     token start_tok;
     token end_tok;
@@ -53,6 +98,11 @@ struct expr {
     expr *next;  // only used in expression list
 
     expr_type type;
+    quick_kind quick;
+
+    // string literal, list literal of constants: the store all of its
+    // evaluations share once the first one built it
+    struct object *constant;
     union {
         // program
         // list literal
@@ -65,6 +115,14 @@ struct expr {
         struct {
             const char *literal;
             size_t length;
+
+            const symbol *sym;  // identifier
+
+            // identifier, slot `slot` of the frame `depth` functions out,
+            // which must have `layout`. NULL when left to lookups by name
+            const frame_layout *layout;
+            uint32_t depth;
+            uint32_t slot;
         };
 
         // char literal
@@ -76,6 +134,9 @@ struct expr {
         // float literal
         double float_value;
 
+        // argument, taken over by whatever evaluates it
+        struct object *value;
+
         // prefix
         // assign
         // infix
@@ -83,6 +144,9 @@ struct expr {
             token op;
             expr *right;
             expr *left;
+
+            frame_layout *fn_layout;  // function literal
+            chunk *fn_code;           // function literal, when compiled
         };
 
         // ternary
@@ -96,6 +160,12 @@ struct expr {
         struct {
             expr *function;
             expr_list params;
+
+            // the function a QUICK_CLOSURE call reaches
+            const frame_layout *known_layout;
+            const expr *known_params;
+
+            bool is_tail_call;  // in tail position of a function body
         };
 
         // index
@@ -116,4 +186,11 @@ void print_ast(expr *program);
 
 void el_append(expr_list *, expr *);
 
+// whether the callee of call_expr is receiver.function, which is called
+// with the receiver as its first argument
+bool is_method_call(const expr *call_expr);
+
+// whether every item of list_literal is a char, int, float or unit literal
+bool is_constant_list(const expr *list_literal);
+
 #endif  // AST_H
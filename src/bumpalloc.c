@@ -23,6 +23,9 @@ void ba_init(bump_alloc *ba) {
 
     ba->pages = 0;
     ba->size = 0;
+
+    ba->resident_pages = 0;
+    ba->reclaimed = 0;
 }
 
 void *ba_malloc(bump_alloc *ba, size_t size) {
@@ -51,6 +54,10 @@ void ba_reserve(bump_alloc *ba, size_t size) {
 
         ba->next_page = (byte *)ba->next_page + bytes_to_commit;
     }
+
+    size_t used_pages = (ba->size + size + page_size - 1) / page_size;
+    if (used_pages > ba->resident_pages)
+        ba->resident_pages = used_pages;
 }
 
 void ba_reset(bump_alloc *ba) {
@@ -59,6 +66,9 @@ void ba_reset(bump_alloc *ba) {
         perror("madvise failed");
         exit(1);
     }
+    ba->reclaimed += ba->resident_pages * page_size;
+    ba->resident_pages = 0;
+
     ba->size = 0;
     ba->pages = 0;
     ba->next_page = ba->store;
@@ -82,5 +92,19 @@ void ba_free(bump_alloc *ba, size_t size) {
         ba->size -= size;
     }
 
-    // TODO: madvise pages that are no longer required
+    size_t used_pages = (ba->size + page_size - 1) / page_size;
+    if (ba->resident_pages < used_pages + 2 * BUMP_ALLOC_RETAIN_PAGES)
+        return;
+
+    size_t keep_pages = used_pages + BUMP_ALLOC_RETAIN_PAGES;
+    size_t release_pages = ba->resident_pages - keep_pages;
+
+    if (madvise(ba->store + keep_pages * page_size, release_pages * page_size,
+                MADV_DONTNEED) != 0) {
+        perror("madvise failed");
+        exit(1);
+    }
+
+    ba->resident_pages = keep_pages;
+    ba->reclaimed += release_pages * page_size;
 }
@@ -9,6 +9,12 @@
 #define BUMP_ALLOC_RESERVE_SIZE 5llu * 1024llu * 1024llu * 1024llu  // 5 gigabytes
 #endif
 
+// unused pages past the top kept resident after a ba_free, once twice this
+// many are unused the rest are released
+#ifndef BUMP_ALLOC_RETAIN_PAGES
+#define BUMP_ALLOC_RETAIN_PAGES 16
+#endif
+
 typedef unsigned char byte;
 
 typedef struct {
@@ -16,6 +22,9 @@ typedef struct {
     size_t pages;
     byte *store;
     byte *next_page;
+
+    size_t resident_pages;  // committed pages not yet returned with madvise
+    size_t reclaimed;       // bytes returned to the os over the allocator's lifetime
 } bump_alloc;
 
 void ba_init(bump_alloc *ba);
@@ -0,0 +1,595 @@
+#include "compiler.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+#include "object.h"
+
+extern arena a;
+
+typedef struct {
+    instr *code;
+    size_t size;
+    size_t capacity;
+
+    const expr **exprs;
+    size_t expr_count;
+    size_t expr_capacity;
+
+    object_slot *constants;
+    size_t constant_count;
+    size_t constant_capacity;
+
+    size_t depth;
+    size_t max_depth;
+} compiler;
+
+// clang-format off
+static const char *const opcode_literals[OP_ENUM_LENGTH] = {
+    [OP_CONST]         = "CONST",
+    [OP_UNIT]          = "UNIT",
+    [OP_LOAD_LOCAL]    = "LOAD_LOCAL",
+    [OP_LOAD]          = "LOAD",
+    [OP_EVAL]          = "EVAL",
+    [OP_POP]           = "POP",
+    [OP_ASSIGN]        = "ASSIGN",
+    [OP_LIST]          = "LIST",
+    [OP_INDEX]         = "INDEX",
+    [OP_PREFIX]        = "PREFIX",
+    [OP_ADD]           = "ADD",
+    [OP_SUB]           = "SUB",
+    [OP_MUL]           = "MUL",
+    [OP_DIV]           = "DIV",
+    [OP_LT]            = "LT",
+    [OP_GT]            = "GT",
+    [OP_LT_EQ]         = "LT_EQ",
+    [OP_GT_EQ]         = "GT_EQ",
+    [OP_EQ]            = "EQ",
+    [OP_NOT_EQ]        = "NOT_EQ",
+    [OP_INFIX]         = "INFIX",
+    [OP_FUNCTION]      = "FUNCTION",
+    [OP_COMPOSE]       = "COMPOSE",
+    [OP_CHECK_PIPE]    = "CHECK_PIPE",
+    [OP_BIND]          = "BIND",
+    [OP_JUMP]          = "JUMP",
+    [OP_JUMP_IF_FALSE] = "JUMP_IF_FALSE",
+    [OP_PREPARE_CALL]  = "PREPARE_CALL",
+    [OP_CALL]          = "CALL",
+    [OP_TAIL_CALL]     = "TAIL_CALL",
+    [OP_RETURN]        = "RETURN",
+};
+
+// values pushed minus values popped, OP_LIST and OP_CALL depend on a
+static const int stack_effects[OP_ENUM_LENGTH] = {
+    [OP_CONST]         = 1,
+    [OP_UNIT]          = 1,
+    [OP_LOAD_LOCAL]    = 1,
+    [OP_LOAD]          = 1,
+    [OP_EVAL]          = 1,
+    [OP_POP]           = -1,
+    [OP_INDEX]         = -1,
+    [OP_ADD]           = -1,
+    [OP_SUB]           = -1,
+    [OP_MUL]           = -1,
+    [OP_DIV]           = -1,
+    [OP_LT]            = -1,
+    [OP_GT]            = -1,
+    [OP_LT_EQ]         = -1,
+    [OP_GT_EQ]         = -1,
+    [OP_EQ]            = -1,
+    [OP_NOT_EQ]        = -1,
+    [OP_INFIX]         = -1,
+    [OP_FUNCTION]      = 1,
+    [OP_COMPOSE]       = -1,
+    [OP_BIND]          = -1,
+    [OP_JUMP_IF_FALSE] = -1,
+    [OP_RETURN]        = -1,
+};
+// clang-format on
+
+static void compile_expr(compiler *c, expr *e);
+static void compile_nested(expr *e);
+
+static void *grow(void *items, size_t *capacity, size_t item_size) {
+    *capacity = *capacity ? 2 * *capacity : 16;
+    items = realloc(items, *capacity * item_size);
+
+    if (items == NULL) {
+        fprintf(stderr, "Error malloc chunk");
+        exit(1);
+    }
+
+    return items;
+}
+
+static size_t emit(compiler *c, opcode op, uint32_t a, uint32_t b) {
+    if (c->size == c->capacity)
+        c->code = (instr *)grow(c->code, &c->capacity, sizeof(instr));
+
+    c->code[c->size] = (instr){
+        .op = op,
+        .a = a,
+        .b = b,
+    };
+
+    switch (op) {
+        case OP_LIST: {
+            c->depth = c->depth - a + 1;
+        } break;
+        case OP_CALL:
+        case OP_TAIL_CALL: {
+            c->depth -= a;
+        } break;
+        default: {
+            c->depth += stack_effects[op];
+        }
+    }
+
+    if (c->depth > c->max_depth)
+        c->max_depth = c->depth;
+
+    return c->size++;
+}
+
+static uint32_t add_expr(compiler *c, const expr *e) {
+    if (c->expr_count == c->expr_capacity)
+        c->exprs = (const expr **)grow(c->exprs, &c->expr_capacity, sizeof(expr *));
+
+    c->exprs[c->expr_count] = e;
+    return (uint32_t)c->expr_count++;
+}
+
+static uint32_t add_constant(compiler *c, object_type type) {
+    if (c->constant_count == c->constant_capacity)
+        c->constants =
+            (object_slot *)grow(c->constants, &c->constant_capacity, sizeof(object_slot));
+
+    object *o = (object *)(c->constants + c->constant_count);
+    memset(o, 0, sizeof(object_slot));
+    o->rc = OBJECT_RC_UNCOUNTED;
+    o->type = type;
+
+    return (uint32_t)c->constant_count++;
+}
+
+static inline object *constant(compiler *c, uint32_t k) {
+    return (object *)(c->constants + k);
+}
+
+// points the jump at `at` to the next instruction
+static void patch_jump(compiler *c, size_t at) {
+    c->code[at].b = (uint32_t)c->size;
+}
+
+static void compile_list(compiler *c, const expr_list *list) {
+    for (expr *e = list->head; e != NULL; e = e->next) {
+        compile_expr(c, e);
+    }
+}
+
+static void compile_sequence(compiler *c, const expr_list *list) {
+    if (list->size == 0) {
+        emit(c, OP_UNIT, 0, 0);
+        return;
+    }
+
+    for (expr *e = list->head; e != NULL; e = e->next) {
+        compile_expr(c, e);
+        if (e->next != NULL)
+            emit(c, OP_POP, 0, 0);
+    }
+}
+
+// the value of e is computed by the tree walker, the function literals in
+// it are still compiled
+static void compile_eval(compiler *c, expr *e) {
+    emit(c, OP_EVAL, 0, add_expr(c, e));
+    compile_nested(e);
+}
+
+static chunk *finish_chunk(compiler *c) {
+    chunk *ch = (chunk *)ba_malloc(&a.expr_alloc, sizeof(chunk));
+
+    *ch = (chunk){
+        .size = c->size,
+        .max_stack = c->max_depth,
+    };
+
+    // chunks live as long as the rest of the tree
+    ch->code = (instr *)ba_malloc(&a.expr_alloc, c->size * sizeof(instr));
+    memcpy(ch->code, c->code, c->size * sizeof(instr));
+
+    if (c->expr_count > 0) {
+        ch->exprs = (const expr **)ba_malloc(&a.expr_alloc, c->expr_count * sizeof(expr *));
+        memcpy(ch->exprs, c->exprs, c->expr_count * sizeof(expr *));
+    }
+
+    if (c->constant_count > 0) {
+        ch->constants =
+            (object_slot *)ba_malloc(&a.expr_alloc, c->constant_count * sizeof(object_slot));
+        memcpy(ch->constants, c->constants, c->constant_count * sizeof(object_slot));
+    }
+
+    free(c->code);
+    free(c->exprs);
+    free(c->constants);
+
+    return ch;
+}
+
+static void compile_function(expr *function_literal) {
+    if (function_literal->fn_code != NULL)
+        return;
+
+    compiler c = {0};
+    compile_expr(&c, function_literal->right);
+    emit(&c, OP_RETURN, 0, 0);
+
+    function_literal->fn_code = finish_chunk(&c);
+}
+
+static inline bool is_function_literal(const expr *e) {
+    return e->type == EXPR_TYPE_INFIX_EXPRESSION && e->op.type == TOKEN_TYPE_RIGHT_ARROW;
+}
+
+static void compile_nested_list(const expr_list *list) {
+    for (expr *e = list->head; e != NULL; e = e->next) {
+        compile_nested(e);
+    }
+}
+
+// compiles the function literals in a tree walked expression
+static void compile_nested(expr *e) {
+    if (e == NULL)
+        return;
+
+    switch (e->type) {
+        case EXPR_TYPE_PROGRAM:
+        case EXPR_TYPE_LIST_LITERAL:
+        case EXPR_TYPE_BLOCK_EXPRESSION: {
+            compile_nested_list(&e->expressions);
+        } break;
+        case EXPR_TYPE_PREFIX_EXPRESSION: {
+            compile_nested(e->right);
+        } break;
+        case EXPR_TYPE_INFIX_EXPRESSION: {
+            if (is_function_literal(e)) {
+                compile_function(e);
+                return;
+            }
+            compile_nested(e->left);
+            compile_nested(e->right);
+        } break;
+        case EXPR_TYPE_TERNARY_EXPRESSION: {
+            compile_nested(e->condition);
+            compile_nested(e->consequence);
+            compile_nested(e->alternative);
+        } break;
+        case EXPR_TYPE_CALL_EXPRESSION: {
+            compile_nested(e->function);
+            compile_nested_list(&e->params);
+        } break;
+        case EXPR_TYPE_INDEX_EXPRESSION: {
+            compile_nested(e->list);
+            compile_nested(e->index);
+        } break;
+        case EXPR_TYPE_CASE_EXPRESSION: {
+            compile_nested_list(&e->conditions);
+            compile_nested_list(&e->results);
+        } break;
+        default: {
+        }
+    }
+}
+
+static void compile_identifier(compiler *c, expr *ident) {
+    uint32_t idx = add_expr(c, ident);
+
+    // a chunk runs in frames of the layout its identifiers resolved to
+    if (ident->layout != NULL && ident->depth == 0) {
+        emit(c, OP_LOAD_LOCAL, ident->slot, idx);
+    } else {
+        emit(c, OP_LOAD, 0, idx);
+    }
+}
+
+static void compile_prefix(compiler *c, expr *prefix_expr) {
+    switch (prefix_expr->op.type) {
+        case TOKEN_TYPE_MINUS:
+        case TOKEN_TYPE_BANG:
+        case TOKEN_TYPE_NOT: {
+            compile_expr(c, prefix_expr->right);
+            emit(c, OP_PREFIX, 0, add_expr(c, prefix_expr));
+        } break;
+        default: {
+            compile_eval(c, prefix_expr);
+        }
+    }
+}
+
+static void compile_infix(compiler *c, expr *infix_expr) {
+    opcode op;
+
+    switch (infix_expr->op.type) {
+        case TOKEN_TYPE_ASSIGN:
+        case TOKEN_TYPE_COLON_COLON: {
+            compile_expr(c, infix_expr->right);
+            compile_nested(infix_expr->left);
+            emit(c, OP_ASSIGN, 0, add_expr(c, infix_expr));
+        } return;
+        case TOKEN_TYPE_RIGHT_ARROW: {
+            compile_function(infix_expr);
+            emit(c, OP_FUNCTION, 0, add_expr(c, infix_expr));
+        } return;
+        case TOKEN_TYPE_LEFT_COMPOSE:
+        case TOKEN_TYPE_RIGHT_COMPOSE: {
+            // the outer function is evaluated first, as the tree walker does
+            bool left = infix_expr->op.type == TOKEN_TYPE_LEFT_COMPOSE;
+            compile_expr(c, left ? infix_expr->left : infix_expr->right);
+            compile_expr(c, left ? infix_expr->right : infix_expr->left);
+            emit(c, OP_COMPOSE, 0, add_expr(c, infix_expr));
+        } return;
+        case TOKEN_TYPE_DOT:
+        case TOKEN_TYPE_LEFT_PIPE:
+        case TOKEN_TYPE_RIGHT_PIPE: {
+            // the function is checked before its argument is evaluated
+            bool left = infix_expr->op.type == TOKEN_TYPE_LEFT_PIPE;
+            uint32_t idx = add_expr(c, infix_expr);
+            compile_expr(c, left ? infix_expr->left : infix_expr->right);
+            emit(c, OP_CHECK_PIPE, 0, idx);
+            compile_expr(c, left ? infix_expr->right : infix_expr->left);
+            emit(c, OP_BIND, 0, idx);
+        } return;
+        case TOKEN_TYPE_PLUS: {
+            op = OP_ADD;
+        } break;
+        case TOKEN_TYPE_MINUS: {
+            op = OP_SUB;
+        } break;
+        case TOKEN_TYPE_ASTERISK: {
+            op = OP_MUL;
+        } break;
+        case TOKEN_TYPE_SLASH: {
+            op = OP_DIV;
+        } break;
+        case TOKEN_TYPE_LT: {
+            op = OP_LT;
+        } break;
+        case TOKEN_TYPE_GT: {
+            op = OP_GT;
+        } break;
+        case TOKEN_TYPE_LT_EQ: {
+            op = OP_LT_EQ;
+        } break;
+        case TOKEN_TYPE_GT_EQ: {
+            op = OP_GT_EQ;
+        } break;
+        case TOKEN_TYPE_EQ: {
+            op = OP_EQ;
+        } break;
+        case TOKEN_TYPE_NOT_EQ: {
+            op = OP_NOT_EQ;
+        } break;
+        default: {
+            op = OP_INFIX;
+        }
+    }
+
+    compile_expr(c, infix_expr->left);
+    compile_expr(c, infix_expr->right);
+    emit(c, op, 0, add_expr(c, infix_expr));
+}
+
+static void compile_ternary(compiler *c, expr *ternary_expr) {
+    compile_expr(c, ternary_expr->condition);
+    size_t to_alternative = emit(c, OP_JUMP_IF_FALSE, 0, 0);
+
+    compile_expr(c, ternary_expr->consequence);
+    size_t to_end = emit(c, OP_JUMP, 0, 0);
+
+    // only one of the branches pushes its value
+    --c->depth;
+
+    patch_jump(c, to_alternative);
+    compile_expr(c, ternary_expr->alternative);
+    patch_jump(c, to_end);
+}
+
+static void compile_case(compiler *c, expr *case_expr) {
+    size_t cases = case_expr->conditions.size;
+    size_t *to_end = (size_t *)malloc(cases * sizeof(size_t));
+
+    if (to_end == NULL && cases > 0) {
+        fprintf(stderr, "Error malloc case jumps");
+        exit(1);
+    }
+
+    expr *condition_expr = case_expr->conditions.head;
+    expr *result_expr = case_expr->results.head;
+
+    for (size_t i = 0; i < cases; ++i) {
+        compile_expr(c, condition_expr);
+        // conditions are tested without dereferencing, as the tree walker does
+        size_t to_next = emit(c, OP_JUMP_IF_FALSE, 1, 0);
+
+        compile_expr(c, result_expr);
+        to_end[i] = emit(c, OP_JUMP, 0, 0);
+        --c->depth;
+
+        patch_jump(c, to_next);
+
+        condition_expr = condition_expr->next;
+        result_expr = result_expr->next;
+    }
+
+    emit(c, OP_UNIT, 0, 0);
+
+    for (size_t i = 0; i < cases; ++i) {
+        patch_jump(c, to_end[i]);
+    }
+
+    free(to_end);
+}
+
+// builtins evaluate their own arguments, so the callee is checked before
+// any argument is pushed. The receiver of a method call is pushed as the
+// first argument
+static void compile_call(compiler *c, expr *call_expr) {
+    uint32_t idx = add_expr(c, call_expr);
+    bool method = is_method_call(call_expr);
+
+    compile_expr(c, method ? call_expr->function->right : call_expr->function);
+    size_t prepare = emit(c, OP_PREPARE_CALL, 0, idx);
+
+    if (method)
+        compile_expr(c, call_expr->function->left);
+
+    compile_list(c, &call_expr->params);
+    emit(c, call_expr->is_tail_call ? OP_TAIL_CALL : OP_CALL,
+         (uint32_t)(call_expr->params.size + method), idx);
+
+    c->code[prepare].a = (uint32_t)c->size;
+}
+
+static void compile_expr(compiler *c, expr *e) {
+    switch (e->type) {
+        case EXPR_TYPE_PROGRAM:
+        case EXPR_TYPE_BLOCK_EXPRESSION: {
+            compile_sequence(c, &e->expressions);
+        } break;
+        case EXPR_TYPE_UNIT: {
+            emit(c, OP_UNIT, 0, 0);
+        } break;
+        case EXPR_TYPE_IDENTIFIER: {
+            compile_identifier(c, e);
+        } break;
+        case EXPR_TYPE_CHAR_LITERAL: {
+            uint32_t k = add_constant(c, OBJECT_TYPE_CHAR);
+            constant(c, k)->char_value = e->char_value;
+            emit(c, OP_CONST, 0, k);
+        } break;
+        case EXPR_TYPE_INT_LITERAL: {
+            uint32_t k = add_constant(c, OBJECT_TYPE_INT);
+            constant(c, k)->int_value = e->int_value;
+            emit(c, OP_CONST, 0, k);
+        } break;
+        case EXPR_TYPE_FLOAT_LITERAL: {
+            uint32_t k = add_constant(c, OBJECT_TYPE_FLOAT);
+            constant(c, k)->float_value = e->float_value;
+            emit(c, OP_CONST, 0, k);
+        } break;
+        case EXPR_TYPE_LIST_LITERAL: {
+            // built once by the evaluator and shared
+            if (is_constant_list(e)) {
+                compile_eval(c, e);
+                break;
+            }
+
+            compile_list(c, &e->expressions);
+            emit(c, OP_LIST, (uint32_t)e->expressions.size, 0);
+        } break;
+        case EXPR_TYPE_PREFIX_EXPRESSION: {
+            compile_prefix(c, e);
+        } break;
+        case EXPR_TYPE_INFIX_EXPRESSION: {
+            compile_infix(c, e);
+        } break;
+        case EXPR_TYPE_TERNARY_EXPRESSION: {
+            compile_ternary(c, e);
+        } break;
+        case EXPR_TYPE_CALL_EXPRESSION: {
+            compile_call(c, e);
+        } break;
+        case EXPR_TYPE_INDEX_EXPRESSION: {
+            compile_expr(c, e->list);
+            compile_expr(c, e->index);
+            emit(c, OP_INDEX, 0, add_expr(c, e));
+        } break;
+        case EXPR_TYPE_CASE_EXPRESSION: {
+            compile_case(c, e);
+        } break;
+        default: {
+            compile_eval(c, e);
+        }
+    }
+}
+
+chunk *compile_program(expr *program) {
+    compiler c = {0};
+    compile_expr(&c, program);
+    emit(&c, OP_RETURN, 0, 0);
+
+    return finish_chunk(&c);
+}
+
+static void print_instr(const chunk *c, size_t i) {
+    const instr *in = c->code + i;
+    printf("%4zu: %-13s", i, opcode_literals[in->op]);
+
+    switch (in->op) {
+        case OP_CONST: {
+            object *k = (object *)(c->constants + in->b);
+            switch (k->type) {
+                case OBJECT_TYPE_CHAR: {
+                    printf(" '%c'", k->char_value);
+                } break;
+                case OBJECT_TYPE_INT: {
+                    printf(" %lld", (long long)k->int_value);
+                } break;
+                default: {
+                    printf(" %g", k->float_value);
+                }
+            }
+        } break;
+        case OP_LOAD_LOCAL:
+        case OP_LOAD: {
+            const expr *ident = c->exprs[in->b];
+            printf(" %.*s", (int)ident->length, ident->literal);
+            if (in->op == OP_LOAD_LOCAL)
+                printf(" (slot %u)", (unsigned)in->a);
+        } break;
+        case OP_LIST:
+        case OP_CALL:
+        case OP_TAIL_CALL: {
+            printf(" %u", (unsigned)in->a);
+        } break;
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE: {
+            printf(" -> %u", in->b);
+        } break;
+        case OP_PREPARE_CALL: {
+            printf(" builtins -> %u", (unsigned)in->a);
+        } break;
+        case OP_EVAL: {
+            const token *tok = &c->exprs[in->b]->start_tok;
+            printf(" at %u:%u", tok->line_number, tok->col_number);
+        } break;
+        default: {
+        }
+    }
+
+    printf("\n");
+}
+
+void print_chunk(const chunk *c, const char *name) {
+    printf("\n%s (stack %zu)\n", name, c->max_stack);
+
+    for (size_t i = 0; i < c->size; ++i) {
+        print_instr(c, i);
+    }
+
+    // functions defined directly in c, each after the code that creates it
+    for (size_t i = 0; i < c->size; ++i) {
+        if (c->code[i].op != OP_FUNCTION)
+            continue;
+
+        const expr *e = c->exprs[c->code[i].b];
+        if (e->fn_code != NULL) {
+            char fn_name[64];
+            snprintf(fn_name, sizeof fn_name, "%s:%u", name, e->start_tok.line_number);
+            print_chunk(e->fn_code, fn_name);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdint.h>
+
+#include "ast.h"
+#include "slot.h"
+
+// a: 24 bit operand, b: 32 bit operand. Expression operands index the
+// chunk's exprs, jump targets are instruction indices
+typedef enum {
+    OP_CONST,       // push constants[b]
+    OP_UNIT,        // push unit
+    OP_LOAD_LOCAL,  // push slot a of the frame, b is the identifier
+    OP_LOAD,        // push identifier b from an outer frame or by name
+    OP_EVAL,        // push the tree walked expression b
+    OP_POP,
+
+    OP_ASSIGN,  // assign the top to the pattern of assignment b
+    OP_LIST,    // replace the top a values with a list of them
+    OP_INDEX,   // replace list and index with the item, index expression b
+    OP_PREFIX,  // apply prefix expression b to the top
+
+    // infix expression b on the top two values, with a fast path for ints
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_LT,
+    OP_GT,
+    OP_LT_EQ,
+    OP_GT_EQ,
+    OP_EQ,
+    OP_NOT_EQ,
+    OP_INFIX,  // any other infix expression b
+
+    OP_FUNCTION,    // push a closure of function literal b
+    OP_COMPOSE,     // replace the outer and inner function with composition b
+    OP_CHECK_PIPE,  // check the top is a function pipe b can bind
+    OP_BIND,        // replace function and argument with the bound function
+
+    OP_JUMP,           // jump to b
+    OP_JUMP_IF_FALSE,  // pop, jump to b when falsy. a tests lvalues as is
+    OP_PREPARE_CALL,   // check the callee of call b, builtins are called
+                       // here and jump to a
+    OP_CALL,           // call with a arguments, call expression b
+    OP_TAIL_CALL,      // OP_CALL replacing the calling frame
+    OP_RETURN,
+
+    OP_ENUM_LENGTH,
+} opcode;
+
+typedef struct {
+    uint32_t op : 8;
+    uint32_t a : 24;
+    uint32_t b;
+} instr;
+
+// compiled expression, living as long as the tree it was compiled from
+struct chunk {
+    instr *code;
+    size_t size;
+
+    const expr **exprs;
+    object_slot *constants;
+
+    size_t max_stack;  // most values the code has on the stack at once
+};
+
+// compiles program and the bodies of the function literals in it, which
+// get their chunk in fn_code
+chunk *compile_program(expr *program);
+
+void print_chunk(const chunk *c, const char *name);
+
+#endif  // COMPILER_H
@@ -3,62 +3,361 @@
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "arena.h"
 
+typedef struct {
+    const symbol *key;
+    size_t slot;
+} global_entry;
+
+static uint64_t global_entry_hash(const void *item) {
+    return ((const global_entry *)item)->key->hash;
+}
+
+static bool global_entry_eq(const void *item, const void *key) {
+    return ((const global_entry *)item)->key == (const symbol *)key;
+}
+
+// Frames of layouts that don't escape die with the call they were made for,
+// while the function being called keeps its outer environment alive. They
+// don't count a reference to it, and are kept on their layout for the next
+// call instead of being freed with their slots
+#define FRAME_POOL_MAX 32
+
+static inline bool is_pooled(const frame_layout *layout) {
+    return layout != NULL && !layout->escapes;
+}
+
 void environment_init(environment *env, environment *outer, hash_table *ht,
-                      size_t scope) {
+                      size_t scope, frame_layout *layout) {
     *env = (environment){
         .outer = outer,
         .ht = ht,
         .scope = scope,
+        .layout = layout,
 
         .selected_options = outer ? outer->selected_options : NULL,
     };
+
+    if (outer == NULL) {
+        env->layout = (frame_layout *)calloc(1, sizeof(frame_layout));
+        env->global_index = (swiss_table *)malloc(sizeof(swiss_table));
+
+        // pages of the reservation are only committed once touched
+        void *slots = mmap(NULL, ENV_GLOBALS_MAX * sizeof(env_binding), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (env->layout == NULL || env->global_index == NULL || slots == MAP_FAILED) {
+            fprintf(stderr, "Error malloc global environment");
+            exit(1);
+        }
+
+        st_init(env->global_index, sizeof(global_entry));
+        env->slots = (env_binding *)slots;
+        return;
+    }
+
+    // closures made in this frame may outlive the function that made it
+    if (outer->obj != NULL && !is_pooled(layout))
+        ++outer->obj->rc;
+
+    if (layout != NULL && layout->size > 0) {
+        env->slots = (env_binding *)calloc(layout->size, sizeof(env_binding));
+
+        if (env->slots == NULL) {
+            fprintf(stderr, "Error malloc environment");
+            exit(1);
+        }
+    }
+}
+
+// function layouts are small enough for a linear scan
+bool layout_find(const frame_layout *layout, const symbol *key, size_t *slot) {
+    for (size_t i = 0; i < layout->size; ++i) {
+        if (layout->vars[i] == key) {
+            *slot = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void layout_append(frame_layout *layout, const symbol *key) {
+    if (layout->size == layout->capacity) {
+        layout->capacity = layout->capacity ? 2 * layout->capacity : 8;
+        layout->vars = (const symbol **)realloc(layout->vars, layout->capacity * sizeof(symbol *));
+
+        if (layout->vars == NULL) {
+            fprintf(stderr, "Error malloc environment");
+            exit(1);
+        }
+    }
+
+    layout->vars[layout->size++] = key;
+}
+
+// the slot of a variable in env's own layout, bound or not
+static env_binding *local_binding(environment *env, const symbol *key) {
+    if (env->global_index != NULL) {
+        global_entry *entry = (global_entry *)st_find(env->global_index, key->hash, key,
+                                                      global_entry_eq);
+        return entry ? env->slots + entry->slot : NULL;
+    }
+
+    size_t slot;
+    if (env->layout == NULL || !layout_find(env->layout, key, &slot))
+        return NULL;
+
+    env_binding *binding = env->slots + slot;
+    return binding->is_cell ? cell_binding(binding) : binding;
+}
+
+// gives a global variable a slot
+size_t env_declare(environment *env, const symbol *key) {
+    assert(env->outer == NULL);
+
+    global_entry *entry = (global_entry *)st_find(env->global_index, key->hash, key,
+                                                  global_entry_eq);
+    if (entry != NULL)
+        return entry->slot;
+
+    frame_layout *layout = env->layout;
+
+    if (layout->size == ENV_GLOBALS_MAX) {
+        fprintf(stderr, "Too many global variables");
+        exit(1);
+    }
+
+    layout_append(layout, key);
+
+    entry = (global_entry *)st_insert(env->global_index, key->hash, global_entry_hash);
+    *entry = (global_entry){
+        .key = key,
+        .slot = layout->size - 1,
+    };
+
+    return entry->slot;
+}
+
+env_binding *cell_binding(env_binding *binding) {
+    return &slot_obj(&binding->value)->cell;
+}
+
+void env_capture(env_binding *dst, env_binding *src) {
+    if (!src->is_cell) {
+        object *cell = new_obj(OBJECT_TYPE_CELL, 1);
+        cell->cell = *src;
+
+        *src = (env_binding){
+            .is_bound = true,
+            .is_cell = true,
+        };
+        slot_set_ref(&src->value, cell);
+    }
+
+    *dst = *src;
+    slot_retain(&dst->value);
+}
+
+// takes over the references held by value, releasing the old one
+void env_bind(env_binding *binding, const object_slot *value, bool is_const) {
+    if (binding->is_bound)
+        slot_release(&binding->value);
+
+    *binding = (env_binding){
+        .value = *value,
+        .is_const = is_const,
+        .is_bound = true,
+    };
 }
 
-bool env_set(environment *env, const char *key, size_t key_length,
-             object *value, bool is_const) {
-    assert(key_length <= VARIABLE_MAX_LENGTH);
+bool env_set(environment *env, const symbol *key, const object_slot *value, bool is_const) {
+    env_binding *binding = local_binding(env, key);
+
+    if (binding == NULL && env->outer == NULL)
+        binding = env->slots + env_declare(env, key);
+
+    if (binding != NULL) {
+        if (binding->is_bound && (binding->is_const || is_const))
+            return false;
+
+        env_bind(binding, value, is_const);
+        return true;
+    }
+
     table_item item = {
-        .key_length = key_length,
+        .key = key,
         .scope = env->scope,
-        .value = value,
+        .value = *value,
         .is_const = is_const,
     };
 
-    memcpy(item.key, key, key_length);
+    bool is_new = !ht_get(env->ht, key, env->scope, NULL, NULL);
+
+    if (!ht_set(env->ht, &item))
+        return false;
+
+    if (is_new)
+        layout_append(&env->overflow, key);
 
-    return ht_set(env->ht, &item);
+    return true;
 }
 
-bool env_get(environment *env, const char *key, size_t key_length, object **value,
-             bool *is_const) {
-    bool ok = ht_get(env->ht, key, key_length, env->scope, value, is_const);
+bool env_get(environment *env, const symbol *key, object **value, bool *is_const) {
+    env_binding *binding = local_binding(env, key);
+
+    if (binding != NULL && binding->is_bound) {
+        if (value != NULL)
+            *value = slot_obj(&binding->value);
+        if (is_const != NULL)
+            *is_const = binding->is_const;
+        return true;
+    }
+
+    bool ok = ht_get(env->ht, key, env->scope, value, is_const);
     if (ok) return ok;
     if (env->outer != NULL) {
-        return env_get(env->outer, key, key_length, value, is_const);
+        return env_get(env->outer, key, value, is_const);
     }
     return ok;
 }
 
-bool env_contains_local_scope(environment *env, const char *key,
-                              size_t key_length) {
-    return ht_get(env->ht, key, key_length, env->scope, NULL, NULL);
+bool env_contains_local_scope(environment *env, const symbol *key) {
+    env_binding *binding = local_binding(env, key);
+    if (binding != NULL)
+        return binding->is_bound;
+
+    return ht_get(env->ht, key, env->scope, NULL, NULL);
 }
 
-void env_destroy(environment *env) {
-    // TODO: implement list of allocated objects to destroy more efficiently
+object *env_new_frame(environment *outer, hash_table *ht, size_t scope, frame_layout *layout) {
+    object *frame_obj = is_pooled(layout) ? layout->free_frames : NULL;
+
+    if (frame_obj == NULL) {
+        frame_obj = new_obj(OBJECT_TYPE_ENVIRONMENT, 1);
+        environment_init(&frame_obj->env, outer, ht, scope, layout);
+        frame_obj->env.obj = frame_obj;
+        return frame_obj;
+    }
 
-    size_t scope = env->scope;
+    // pooled frames are linked through obj, their slots are all unbound
+    layout->free_frames = frame_obj->env.obj;
+    --layout->free_count;
 
-    table_item *cur;
-    for (size_t i = 0; i < env->ht->capacity; ++i) {
-        cur = env->ht->values + i;
-        if (cur->scope == scope) {
-            rc_dec(cur->value);
-            hti_set_avail(cur);
-            --env->ht->size;
+    frame_obj->rc = 1;
+    frame_obj->env = (environment){
+        .outer = outer,
+        .ht = ht,
+        .scope = scope,
+        .layout = layout,
+        .slots = frame_obj->env.slots,
+        .obj = frame_obj,
+        .selected_options = outer->selected_options,
+    };
+
+    return frame_obj;
+}
+
+static void release_bindings(environment *env) {
+    size_t slot_count = env->layout ? env->layout->size : 0;
+
+    for (size_t i = 0; i < slot_count; ++i) {
+        if (env->slots[i].is_bound) {
+            env->slots[i].is_bound = false;
+            slot_release(&env->slots[i].value);
         }
     }
 }
+
+static void remove_overflow(environment *env) {
+    for (size_t i = 0; i < env->overflow.size; ++i)
+        ht_remove(env->ht, env->overflow.vars[i], env->scope);
+
+    free(env->overflow.vars);
+}
+
+bool env_pool_frame(object *frame_obj) {
+    environment *env = &frame_obj->env;
+    frame_layout *layout = env->layout;
+
+    if (env->outer == NULL || !is_pooled(layout) || layout->free_count == FRAME_POOL_MAX)
+        return false;
+
+    release_bindings(env);
+    remove_overflow(env);
+
+    env->obj = layout->free_frames;
+    layout->free_frames = frame_obj;
+    ++layout->free_count;
+
+    return true;
+}
+
+void env_reset_frame(environment *env) {
+    release_bindings(env);
+    remove_overflow(env);
+    env->overflow = (frame_layout){0};
+}
+
+void env_visit_refs(environment *env, void (*visit)(object *)) {
+    size_t slot_count = env->layout ? env->layout->size : 0;
+
+    for (size_t i = 0; i < slot_count; ++i) {
+        object *o = (object *)&env->slots[i].value;
+        if (env->slots[i].is_bound && o->type == OBJECT_TYPE_LVALUE)
+            visit(o->ref);
+    }
+
+    for (size_t i = 0; i < env->overflow.size; ++i) {
+        object *value;
+        if (ht_get(env->ht, env->overflow.vars[i], env->scope, &value, NULL) &&
+            !is_inline_type(value->type))
+            visit(value);
+    }
+
+    if (env->outer != NULL && env->outer->obj != NULL && !is_pooled(env->layout))
+        visit(env->outer->obj);
+}
+
+void env_destroy(environment *env) {
+    release_bindings(env);
+
+    if (env->outer == NULL) {
+        st_destroy(env->global_index);
+        free(env->global_index);
+        free(env->layout->vars);
+        free(env->layout);
+        munmap(env->slots, ENV_GLOBALS_MAX * sizeof(env_binding));
+        return;
+    }
+
+    free(env->slots);
+    remove_overflow(env);
+
+    if (env->outer->obj != NULL && !is_pooled(env->layout))
+        rc_dec(env->outer->obj);
+}
+
+void print_env_info(const environment *env) {
+    const frame_layout *layout = env->layout;
+
+    printf("\n------\n");
+
+    printf("GLOBALS\nSIZE: %zu\n", layout->size);
+
+    if (layout->size > 0)
+        printf("\nVALUES:\n");
+
+    for (size_t i = 0; i < layout->size; ++i) {
+        env_binding *binding = env->slots + i;
+        if (!binding->is_bound)
+            continue;
+        printf("%3zu: value: %3p, const: %d, key: %.*s\n", i,
+               (void *)slot_obj(&binding->value), binding->is_const,
+               (int)layout->vars[i]->length, layout->vars[i]->literal);
+    }
+
+    print_ht_info(env->ht);
+}
@@ -3,26 +3,98 @@
 
 #include <stdbool.h>
 
+#include "ast.h"
 #include "glorpoptions.h"
 #include "hashtable.h"
 
+// most globals a program can declare, their slots are reserved up front so
+// references to them stay valid as more are declared
+#ifndef ENV_GLOBALS_MAX
+#define ENV_GLOBALS_MAX (1llu << 20)
+#endif
+
 typedef struct environment environment;
 
+// A variable captured by a flat closure is moved to a cell shared with
+// it, its binding then only refers to the cell (see env_capture)
+typedef struct {
+    object_slot value;
+    bool is_const;
+    bool is_bound;
+    bool is_cell;
+} env_binding;
+
+// Variables the resolver found are kept in `slots`, laid out by `layout`.
+// Anything else a function frame binds (e.g. a file imported inside a
+// function) goes into the shared hash table under `scope`, and its name
+// into `overflow` so the frame can remove it again. The global
+// environment owns its layout, which grows as programs are resolved, and
+// an index from names to its slots.
 struct environment {
     environment *outer;
     hash_table *ht;
 
     size_t scope;
 
+    frame_layout *layout;
+    env_binding *slots;
+    swiss_table *global_index;
+
+    frame_layout overflow;
+
     object *obj;
 
     const glorp_options *selected_options;
 };
 
-void environment_init(environment *e, environment *outer, hash_table *ht, size_t scope);
-bool env_set(environment *env, const char *key, size_t key_length, object *value, bool is_const);
-bool env_get(environment *env, const char *key, size_t key_length, object **value, bool *is_const);
-bool env_contains_local_scope(environment *env, const char *key, size_t key_length);
+void environment_init(environment *e, environment *outer, hash_table *ht, size_t scope,
+                      frame_layout *layout);
+bool env_set(environment *env, const symbol *key, const object_slot *value, bool is_const);
+bool env_get(environment *env, const symbol *key, object **value, bool *is_const);
+bool env_contains_local_scope(environment *env, const symbol *key);
+size_t env_declare(environment *env, const symbol *key);
+void env_bind(env_binding *binding, const object_slot *value, bool is_const);
 void env_destroy(environment *env);
 
+// the environment object of a call to a function with layout, taken from
+// the layout's pool when it doesn't escape
+object *env_new_frame(environment *outer, hash_table *ht, size_t scope, frame_layout *layout);
+
+// keeps the frame of a finished call for the next call, false when it has
+// to be destroyed instead
+bool env_pool_frame(object *frame_obj);
+
+// unbinds the variables of a frame that doesn't escape, so it can run
+// another call of the same function
+void env_reset_frame(environment *env);
+
+// calls visit with every heap object env holds a count of
+void env_visit_refs(environment *env, void (*visit)(object *));
+
+bool layout_find(const frame_layout *layout, const symbol *key, size_t *slot);
+
+// the binding of the variable a cell binding refers to
+env_binding *cell_binding(env_binding *binding);
+
+// binds dst to the variable bound at src, moving it to a cell first
+void env_capture(env_binding *dst, env_binding *src);
+
+void print_env_info(const environment *env);
+
+// the binding a resolved identifier refers to, NULL when it has to be
+// looked up by name
+static inline env_binding *env_resolved(environment *env, const expr *ident) {
+    if (ident->layout == NULL)
+        return NULL;
+
+    for (uint32_t i = 0; i < ident->depth && env != NULL; ++i)
+        env = env->outer;
+
+    if (env == NULL || env->layout != ident->layout)
+        return NULL;
+
+    env_binding *binding = env->slots + ident->slot;
+    return binding->is_cell ? cell_binding(binding) : binding;
+}
+
 #endif  // ENVIRONMENT_H
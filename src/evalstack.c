@@ -0,0 +1,59 @@
+#include "evalstack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+char *eval_stack_limit;
+
+static ucontext_t caller_ctx;
+static ucontext_t eval_ctx;
+
+static struct {
+    bool (*fn)(void *);
+    void *arg;
+    bool ok;
+} task;
+
+static void run_task(void) {
+    task.ok = task.fn(task.arg);
+}
+
+bool run_on_eval_stack(size_t size, bool (*fn)(void *), void *arg) {
+    // imports evaluate on the stack of the file importing them
+    if (eval_stack_limit != NULL)
+        return fn(arg);
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size = (size + page - 1) / page * page;
+
+    if (size < 2 * EVAL_STACK_RESERVE)
+        size = 2 * EVAL_STACK_RESERVE;
+
+    char *stack = (char *)mmap(NULL, size + page, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (stack == MAP_FAILED || mprotect(stack, page, PROT_NONE) != 0) {
+        fprintf(stderr, "Error mmap eval stack");
+        exit(1);
+    }
+
+    task.fn = fn;
+    task.arg = arg;
+
+    getcontext(&eval_ctx);
+    eval_ctx.uc_stack.ss_sp = stack + page;
+    eval_ctx.uc_stack.ss_size = size;
+    eval_ctx.uc_link = &caller_ctx;
+    makecontext(&eval_ctx, run_task, 0);
+
+    eval_stack_limit = stack + page + EVAL_STACK_RESERVE;
+    swapcontext(&caller_ctx, &eval_ctx);
+    eval_stack_limit = NULL;
+
+    munmap(stack, size + page);
+
+    return task.ok;
+}
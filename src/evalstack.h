@@ -0,0 +1,23 @@
+#ifndef EVALSTACK_H
+#define EVALSTACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// room left below the stack limit for whatever runs after the last check
+#ifndef EVAL_STACK_RESERVE
+#define EVAL_STACK_RESERVE (256 * 1024)
+#endif
+
+// lowest address evaluation may reach, NULL when not on the eval stack
+extern char *eval_stack_limit;
+
+// Runs fn(arg) on an mmap'd stack of size bytes with a guard page below
+// it, or directly when already running on one.
+bool run_on_eval_stack(size_t size, bool (*fn)(void *), void *arg);
+
+static inline bool eval_stack_exhausted(void) {
+    return (char *)__builtin_frame_address(0) < eval_stack_limit;
+}
+
+#endif  // EVALSTACK_H
@@ -8,9 +8,12 @@
 
 #include "arena.h"
 #include "error.h"
+#include "evalstack.h"
+#include "gc.h"
 #include "interpreter.h"
 #include "sb.h"
 #include "utils.h"
+#include "vm.h"
 
 #define ARGS_VAR_NAME "args"
 
@@ -25,6 +28,15 @@
 static size_t scope_counter = 1;
 eval_error eval_err;
 
+size_t call_depth;
+
+// a call made in tail position, left for run_body to run in place of the
+// frame that made it
+static struct {
+    object func;
+    object *env_obj;  // NULL when no call is pending
+} pending_tail;
+
 typedef bool eval_fn(const expr *, environment *env, object *result);
 typedef bool assign_fn(const expr *lhs,
                        const object *rhs,
@@ -62,11 +74,11 @@ static eval_fn eval_infix_expression;
 static eval_fn eval_ternary_expression;
 static eval_fn eval_call_expression;
 static eval_fn eval_index_expression;
-static eval_fn eval_function_literal;
 static eval_fn eval_compose_expression;
 static eval_fn eval_pipe_expression;
 static eval_fn eval_case_expression;
 static eval_fn eval_import_expression;
+static eval_fn eval_argument;
 
 static assign_fn assign_lhs;
 static assign_fn assign_ident;
@@ -75,22 +87,28 @@ static assign_fn assign_index;
 static assign_fn assign_tuple;
 static assign_fn assign_prepend;
 
-static object *resolve_assign_rhs(const object *rhs, bool *is_const);
+static void resolve_assign_rhs(const object *rhs, object_slot *slot, bool *is_const);
+
+WARN_UNUSED_RESULT
+static bool eval_derived_call(const expr *call_expr, object *func, environment *env,
+                              object *result);
+
+WARN_UNUSED_RESULT
+static inline bool get_ie_idx(const expr *index_expression, environment *env, size_t *idx, object *list);
 
 WARN_UNUSED_RESULT
-static inline bool get_ie_it(const expr *index_expression, environment *env, ol_iterator *oli, object *list);
+static bool eval_index(const expr *index_expr, environment *env, object *result, bool for_write);
+
+static environment *capture_env(const frame_layout *layout, environment *env);
 
 WARN_UNUSED_RESULT
 static inline bool eval_func_params(expr *params, environment *env, expr_list *parameters);
 
 static inline bool valid_infix_num_types(const object *left, const object *right);
-static inline bool is_truthy(const object *obj);
 static inline bool is_num_type(const object *obj);
 static inline bool is_tuple_exp(const expr *e);
-static inline bool copy_by_value(object_type ot);
 static inline void undefined_var_error(const expr *e);
 static inline void generic_error(const expr *e, const char *msg, ...);
-static inline size_t fn_param_count(const object *fn);
 
 typedef struct {
     char *name;
@@ -116,6 +134,7 @@ eval_fn *eval_fns[EXPR_ENUM_LENGTH] = {
     [EXPR_TYPE_INDEX_EXPRESSION]   = eval_index_expression,
     [EXPR_TYPE_CASE_EXPRESSION]    = eval_case_expression,
     [EXPR_TYPE_IMPORT_EXPRESSION]  = eval_import_expression,
+    [EXPR_TYPE_ARGUMENT]           = eval_argument,
 };
 // clang-format on
 
@@ -125,11 +144,13 @@ bool eval(const expr *e, environment *env, object *result) {
 }
 
 // normal eval but does not result in lvalues, only their underlying value
-// which is then not tracked by reference
+// which is then not tracked by reference. The result owns its references,
+// release it with temp_cleanup
 bool eval_no_l(const expr *e, environment *env, object *result) {
     CHECK_EVAL(eval(e, env, result));
     if (result->type == OBJECT_TYPE_LVALUE) {
-        *result = *result->ref;
+        copy_obj(result, result->ref);
+        temp_retain(result);
     }
     return true;
 }
@@ -137,8 +158,11 @@ bool eval_no_l(const expr *e, environment *env, object *result) {
 static bool eval_program(const expr *program, environment *env, object *result) {
     const expr_list *expressions = &program->expressions;
 
+    object_init(result, OBJECT_TYPE_UNIT);
+
     const expr *exp = expressions->head;
     for (size_t i = 0; i < expressions->size; ++i, exp = exp->next) {
+        temp_cleanup(result);
         CHECK_EVAL(eval(exp, env, result));
     }
     return true;
@@ -152,12 +176,16 @@ static bool eval_unit(const expr *unit, environment *env, object *result) {
 }
 
 static bool eval_identifier(const expr *ident, environment *env, object *result) {
-    const char *key = ident->literal;
-    size_t key_length = ident->length;
-
     object_init(result, OBJECT_TYPE_LVALUE);
 
-    if (!env_get(env, key, key_length, &result->ref, &result->is_const)) {
+    env_binding *binding = env_resolved(env, ident);
+    if (binding != NULL && binding->is_bound) {
+        result->ref = slot_obj(&binding->value);
+        result->is_const = binding->is_const;
+        return true;
+    }
+
+    if (!env_get(env, ident->sym, &result->ref, &result->is_const)) {
         undefined_var_error(ident);
         return false;
     }
@@ -186,40 +214,68 @@ static bool eval_float_literal(const expr *float_literal, environment *env, obje
     return true;
 }
 
+// String literals and list literals of constants build their list once.
+// Its store is kept by the literal as a constant, later evaluations share
+// it and writing to any of them copies it first
+static inline bool eval_constant(const expr *literal, object *result) {
+    if (literal->constant == NULL)
+        return false;
+
+    object_init(result, OBJECT_TYPE_LIST);
+    ol_init_const(&result->values, literal->constant);
+    return true;
+}
+
+static inline void set_constant(const expr *literal, object_list *values) {
+    ((expr *)literal)->constant = ol_make_const(values);
+}
+
 static bool eval_string_literal(const expr *string_literal, environment *env, object *result) {
     (void)env;
+    if (eval_constant(string_literal, result))
+        return true;
+
     const char *literal = string_literal->literal;
     size_t length = string_literal->length;
 
     object_init(result, OBJECT_TYPE_LIST);
-
-    object_list *obj_values = &result->values;
-
-    object *char_obj;
-    for (size_t i = 0; i < length; ++i) {
-        char_obj = new_obj(OBJECT_TYPE_CHAR, 1);
-        char_obj->char_value = literal[i];
-        ol_append(obj_values, char_obj);
-    }
+    ol_init_str(&result->values, literal, length);
+    set_constant(string_literal, &result->values);
 
     return true;
 }
 
 static bool eval_list_literal(const expr *list_literal, environment *env, object *result) {
+    bool is_constant = is_constant_list(list_literal);
+    if (is_constant && eval_constant(list_literal, result))
+        return true;
+
     object_init(result, OBJECT_TYPE_LIST);
 
     object_list *obj_values = &result->values;
 
     const expr_list *exprs = &list_literal->expressions;
 
+    ol_reserve(obj_values, exprs->size);
+
     const expr *cur_expr = exprs->head;
     object cur_obj;
+    object_slot cur_slot;
     for (; cur_expr; cur_expr = cur_expr->next) {
         CHECK_EVAL(eval(cur_expr, env, &cur_obj));
-        object *new_obj = resolve_assign_rhs(&cur_obj, NULL);
-        ol_append(obj_values, new_obj);
+        resolve_assign_rhs(&cur_obj, &cur_slot, NULL);
+        ol_append(obj_values, &cur_slot);
     }
 
+    if (is_constant)
+        set_constant(list_literal, obj_values);
+
+    return true;
+}
+
+static bool eval_argument(const expr *argument, environment *env, object *result) {
+    (void)env;
+    *result = *argument->value;
     return true;
 }
 
@@ -228,6 +284,7 @@ static bool eval_block_expression(const expr *block_expr, environment *env, obje
 
     const expr *cur_expr = block_expr->expressions.head;
     for (; cur_expr; cur_expr = cur_expr->next) {
+        temp_cleanup(result);
         CHECK_EVAL(eval(cur_expr, env, result));
     }
     return true;
@@ -246,11 +303,11 @@ static bool eval_block_expression(const expr *block_expr, environment *env, obje
         } break;                                         \
         case TOKEN_TYPE_PLUS_PLUS: {                     \
             ++obj->obj_field;                            \
-            *og_obj = *obj;                              \
+            copy_obj(og_obj, obj);                       \
         } break;                                         \
         case TOKEN_TYPE_MINUS_MINUS: {                   \
             --obj->obj_field;                            \
-            *og_obj = *obj;                              \
+            copy_obj(og_obj, obj);                       \
         } break;                                         \
         default: {                                       \
         }                                                \
@@ -258,7 +315,7 @@ static bool eval_block_expression(const expr *block_expr, environment *env, obje
 
 static bool eval_prefix_expression(const expr *prefix_expr, environment *env, object *result) {
     const token *op = &prefix_expr->op;
-    object *og_result;
+    object *og_result = NULL;
 
     switch (op->type) {
         case TOKEN_TYPE_COLON_COLON: {
@@ -272,7 +329,11 @@ static bool eval_prefix_expression(const expr *prefix_expr, environment *env, ob
         } break;
         case TOKEN_TYPE_PLUS_PLUS:
         case TOKEN_TYPE_MINUS_MINUS: {
-            CHECK_EVAL(eval(prefix_expr->right, env, result));
+            if (prefix_expr->right->type == EXPR_TYPE_INDEX_EXPRESSION) {
+                CHECK_EVAL(eval_index(prefix_expr->right, env, result, true));
+            } else {
+                CHECK_EVAL(eval(prefix_expr->right, env, result));
+            }
             og_result = result;
             if (result->type != OBJECT_TYPE_LVALUE) {
                 generic_error(prefix_expr, "Expression is not assignable");
@@ -284,6 +345,14 @@ static bool eval_prefix_expression(const expr *prefix_expr, environment *env, ob
         }
     }
 
+    return eval_prefix_value(prefix_expr, result, og_result);
+}
+
+// applies a prefix operator to value in place, og_result receives the new
+// value of an increment or decrement
+bool eval_prefix_value(const expr *prefix_expr, object *result, object *og_result) {
+    const token *op = &prefix_expr->op;
+
     switch (result->type) {
         case OBJECT_TYPE_INT: {
             eval_prefix_num_vals(result, og_result, int_value, op->type);
@@ -301,11 +370,16 @@ static bool eval_prefix_expression(const expr *prefix_expr, environment *env, ob
 }
 
 static bool eval_assign_expression(const expr *assign_expr, environment *env, object *result) {
-    bool is_const = assign_expr->op.type == TOKEN_TYPE_COLON_COLON;
     object right;
     CHECK_EVAL(eval(assign_expr->right, env, &right));
+    return assign_value(assign_expr, &right, env, result);
+}
+
+// assigns the evaluated right hand side of assign_expr
+bool assign_value(const expr *assign_expr, object *right, environment *env, object *result) {
+    bool is_const = assign_expr->op.type == TOKEN_TYPE_COLON_COLON;
     object *heap_obj;
-    CHECK_EVAL(assign_lhs(assign_expr->left, &right, assign_expr, env, is_const, &heap_obj));
+    CHECK_EVAL(assign_lhs(assign_expr->left, right, assign_expr, env, is_const, &heap_obj));
     if (heap_obj) {
         *result = (object){
             .type = OBJECT_TYPE_LVALUE,
@@ -313,7 +387,7 @@ static bool eval_assign_expression(const expr *assign_expr, environment *env, ob
             .is_const = is_const,
         };
     } else {
-        *result = right;
+        *result = *right;
     }
     return true;
 }
@@ -398,39 +472,7 @@ static bool eval_assign_expression(const expr *assign_expr, environment *env, ob
 
 static bool concat_lists(object *left_obj, object *right_obj, object *result) {
     object_init(result, OBJECT_TYPE_LIST);
-
-    object_list *obj_values = &result->values;
-
-    ol_iterator it = ol_start(&left_obj->values);
-
-    for (; !oli_is_end(&it); oli_next(&it)) {
-        if (copy_by_value(it.obj->type)) {
-            object *new_obj = new_empty_obj();
-            *new_obj = *it.obj;
-            new_obj->rc = 1;
-            ol_append(obj_values, new_obj);
-        } else {
-            ++it.obj->rc;
-            ol_append(obj_values, it.obj);
-        }
-    }
-
-    it = ol_start(&right_obj->values);
-
-    for (; !oli_is_end(&it); oli_next(&it)) {
-        if (copy_by_value(it.obj->type)) {
-            object *new_obj = new_empty_obj();
-            *new_obj = *it.obj;
-            new_obj->rc = 1;
-            ol_append(obj_values, new_obj);
-        } else {
-            ++it.obj->rc;
-            ol_append(obj_values, it.obj);
-        }
-    }
-
-    temp_cleanup(left_obj);
-    temp_cleanup(right_obj);
+    ol_concat(&result->values, &left_obj->values, &right_obj->values);
     return true;
 }
 
@@ -461,11 +503,136 @@ static bool eval_infix_expression(const expr *infix_expr, environment *env, obje
     CHECK_EVAL(eval_no_l(left, env, &left_obj));
     CHECK_EVAL(eval_no_l(right, env, &right_obj));
 
+    return eval_infix_values(infix_expr, &left_obj, &right_obj, result);
+}
+
+// Quickening: a node records in expr->quick what its operands turned out
+// to be and takes a guarded fast path while that holds. A node that sees
+// anything else goes back to the generic path for good, so it never flips
+// back and forth.
+static inline void set_quick(const expr *e, quick_kind quick) {
+    ((expr *)e)->quick = quick;
+}
+
+static void quicken_infix(const expr *infix_expr, const object *left, const object *right) {
+    quick_kind quick = QUICK_GENERIC;
+
+    switch (infix_expr->op.type) {
+        case TOKEN_TYPE_SLASH: {
+            // int division keeps the checks of the generic path
+            if (left->type == OBJECT_TYPE_FLOAT && right->type == OBJECT_TYPE_FLOAT)
+                quick = QUICK_FLOAT;
+        } break;
+        case TOKEN_TYPE_PLUS:
+        case TOKEN_TYPE_MINUS:
+        case TOKEN_TYPE_ASTERISK:
+        case TOKEN_TYPE_LT:
+        case TOKEN_TYPE_GT:
+        case TOKEN_TYPE_LT_EQ:
+        case TOKEN_TYPE_GT_EQ:
+        case TOKEN_TYPE_EQ:
+        case TOKEN_TYPE_NOT_EQ: {
+            if (left->type == OBJECT_TYPE_INT && right->type == OBJECT_TYPE_INT)
+                quick = QUICK_INT;
+            else if (left->type == OBJECT_TYPE_FLOAT && right->type == OBJECT_TYPE_FLOAT)
+                quick = QUICK_FLOAT;
+        } break;
+        default: {
+        }
+    }
+
+    set_quick(infix_expr, quick);
+}
+
+#define quick_infix_vals(obj, obj_ty, obj_field, op, lval, rval) \
+    switch (op) {                                                \
+        case TOKEN_TYPE_PLUS: {                                  \
+            obj->type = obj_ty;                                  \
+            obj->obj_field = lval + rval;                        \
+        } break;                                                 \
+        case TOKEN_TYPE_MINUS: {                                 \
+            obj->type = obj_ty;                                  \
+            obj->obj_field = lval - rval;                        \
+        } break;                                                 \
+        case TOKEN_TYPE_ASTERISK: {                              \
+            obj->type = obj_ty;                                  \
+            obj->obj_field = lval * rval;                        \
+        } break;                                                 \
+        case TOKEN_TYPE_SLASH: {                                 \
+            obj->type = obj_ty;                                  \
+            obj->obj_field = lval / rval;                        \
+        } break;                                                 \
+        case TOKEN_TYPE_LT: {                                    \
+            obj->type = OBJECT_TYPE_INT;                         \
+            obj->int_value = lval < rval;                        \
+        } break;                                                 \
+        case TOKEN_TYPE_GT: {                                    \
+            obj->type = OBJECT_TYPE_INT;                         \
+            obj->int_value = lval > rval;                        \
+        } break;                                                 \
+        case TOKEN_TYPE_LT_EQ: {                                 \
+            obj->type = OBJECT_TYPE_INT;                         \
+            obj->int_value = lval <= rval;                       \
+        } break;                                                 \
+        case TOKEN_TYPE_GT_EQ: {                                 \
+            obj->type = OBJECT_TYPE_INT;                         \
+            obj->int_value = lval >= rval;                       \
+        } break;                                                 \
+        case TOKEN_TYPE_EQ: {                                    \
+            obj->type = OBJECT_TYPE_INT;                         \
+            obj->int_value = lval == rval;                       \
+        } break;                                                 \
+        case TOKEN_TYPE_NOT_EQ: {                                \
+            obj->type = OBJECT_TYPE_INT;                         \
+            obj->int_value = lval != rval;                       \
+        } break;                                                 \
+        default: {                                               \
+        }                                                        \
+    }
+
+// the fast path of a quickened infix node, false when its guard fails
+static inline bool quick_infix(const expr *infix_expr, const object *left, const object *right,
+                               object *result) {
+    switch (infix_expr->quick) {
+        case QUICK_INT: {
+            if (left->type != OBJECT_TYPE_INT || right->type != OBJECT_TYPE_INT)
+                break;
+
+            quick_infix_vals(result, OBJECT_TYPE_INT, int_value, infix_expr->op.type,
+                             left->int_value, right->int_value);
+            return true;
+        }
+        case QUICK_FLOAT: {
+            if (left->type != OBJECT_TYPE_FLOAT || right->type != OBJECT_TYPE_FLOAT)
+                break;
+
+            quick_infix_vals(result, OBJECT_TYPE_FLOAT, float_value, infix_expr->op.type,
+                             left->float_value, right->float_value);
+            return true;
+        }
+        case QUICK_UNSEEN: {
+            quicken_infix(infix_expr, left, right);
+        } return false;
+        default: {
+        } return false;
+    }
+
+    set_quick(infix_expr, QUICK_GENERIC);
+    return false;
+}
+
+// applies the operator of infix_expr to operands evaluated with eval_no_l
+bool eval_infix_values(const expr *infix_expr, object *left, object *right, object *result) {
+    token_type op_type = infix_expr->op.type;
+
+    if (quick_infix(infix_expr, left, right, result))
+        return true;
+
     switch (op_type) {
         case TOKEN_TYPE_PLUS: {
-            if (left_obj.type == OBJECT_TYPE_LIST &&
-                right_obj.type == OBJECT_TYPE_LIST) {
-                CHECK_EVAL(concat_lists(&left_obj, &right_obj, result));
+            if (left->type == OBJECT_TYPE_LIST &&
+                right->type == OBJECT_TYPE_LIST) {
+                CHECK_EVAL(concat_lists(left, right, result));
                 return true;
             }
         }
@@ -486,7 +653,7 @@ static bool eval_infix_expression(const expr *infix_expr, environment *env, obje
         case TOKEN_TYPE_XOR:
         case TOKEN_TYPE_LEFT_SHIFT:
         case TOKEN_TYPE_RIGHT_SHIFT: {
-            if (!valid_infix_num_types(&left_obj, &right_obj)) {
+            if (!valid_infix_num_types(left, right)) {
                 // TODO: specify expected types
                 generic_error(infix_expr, "Invalid operands to arithmetic operation");
                 return false;
@@ -498,27 +665,27 @@ static bool eval_infix_expression(const expr *infix_expr, environment *env, obje
         }
     }
 
-    if (left_obj.type == OBJECT_TYPE_FLOAT ||
-        right_obj.type == OBJECT_TYPE_FLOAT) {
+    if (left->type == OBJECT_TYPE_FLOAT ||
+        right->type == OBJECT_TYPE_FLOAT) {
         double left_val;
         double right_val;
 
-        if (left_obj.type == OBJECT_TYPE_INT) {
-            left_val = (double)left_obj.int_value;
+        if (left->type == OBJECT_TYPE_INT) {
+            left_val = (double)left->int_value;
         } else {
-            left_val = left_obj.float_value;
+            left_val = left->float_value;
         }
 
-        if (right_obj.type == OBJECT_TYPE_INT) {
-            right_val = (double)right_obj.int_value;
+        if (right->type == OBJECT_TYPE_INT) {
+            right_val = (double)right->int_value;
         } else {
-            right_val = right_obj.float_value;
+            right_val = right->float_value;
         }
 
         eval_infix_num_vals(result, OBJECT_TYPE_FLOAT, float_value, op_type, left_val, right_val);
     } else {
-        int64_t left_val = left_obj.int_value;
-        int64_t right_val = right_obj.int_value;
+        int64_t left_val = left->int_value;
+        int64_t right_val = right->int_value;
 
         eval_infix_num_vals(result, OBJECT_TYPE_INT, int_value, op_type, left_val, right_val);
     }
@@ -531,7 +698,10 @@ static bool eval_ternary_expression(const expr *ternary_expr, environment *env,
     // TODO: eval assign pattern match differently
     CHECK_EVAL(eval_no_l(ternary_expr->condition, env, &condition_obj));
 
-    if (is_truthy(&condition_obj)) {
+    bool truthy = is_truthy(&condition_obj);
+    temp_cleanup(&condition_obj);
+
+    if (truthy) {
         CHECK_EVAL(eval(ternary_expr->consequence, env, result));
     } else {
         CHECK_EVAL(eval(ternary_expr->alternative, env, result));
@@ -540,18 +710,209 @@ static bool eval_ternary_expression(const expr *ternary_expr, environment *env,
     return true;
 }
 
+// a method call receiver.function(params...) calls the function after the
+// dot with the receiver as its first argument, without binding it first
+static inline const expr *callee_of(const expr *call_expr) {
+    return is_method_call(call_expr) ? call_expr->function->right : call_expr->function;
+}
+
+static inline size_t arg_count(const expr *call_expr) {
+    return call_expr->params.size + is_method_call(call_expr);
+}
+
+static inline const expr *first_arg(const expr *call_expr) {
+    return is_method_call(call_expr) ? call_expr->function->left : call_expr->params.head;
+}
+
+static inline const expr *next_arg(const expr *call_expr, const expr *arg) {
+    if (is_method_call(call_expr) && arg == call_expr->function->left)
+        return call_expr->params.head;
+    return arg->next;
+}
+
 static bool eval_call_expression(const expr *call_expr, environment *env, object *result) {
+    if (eval_stack_exhausted()) {
+        stack_overflow_error(call_expr);
+        return false;
+    }
+
     object func;
-    CHECK_EVAL(eval_no_l(call_expr->function, env, &func));
+    CHECK_EVAL(eval_no_l(callee_of(call_expr), env, &func));
+
+    // decided before the arguments, which may run this call again
+    bool known = is_known_call(call_expr, &func);
+
+    if (!known) {
+        CHECK_EVAL(check_call(call_expr, &func));
+
+        if (func.kind == FUNCTION_KIND_BUILTIN) {
+            return func.builtin_fn(&call_expr->params, call_expr, env, result);
+        }
+
+        if (func.kind != FUNCTION_KIND_NORMAL) {
+            return eval_derived_call(call_expr, &func, env, result);
+        }
+
+        known = quicken_call(call_expr, &func);
+    }
+
+    object *func_env_obj = new_frame(&func, env);
+
+    const expr *func_param = func.params.head;
+    const expr *call_param = first_arg(call_expr);
+
+    object param_obj;
+    for (size_t i = 0; i < func.params.size; ++i) {
+        CHECK_EVAL(eval(call_param, env, &param_obj));
+
+        if (known) {
+            CHECK_EVAL(bind_known_param(func_param, &param_obj, call_expr, &func_env_obj->env));
+        } else {
+            CHECK_EVAL(bind_param(func_param, &param_obj, call_expr, &func_env_obj->env));
+        }
+
+        func_param = func_param->next;
+        call_param = next_arg(call_expr, call_param);
+    }
+
+    if (call_expr->is_tail_call) {
+        pending_tail.func = func;
+        pending_tail.env_obj = func_env_obj;
 
-    if (func.type != OBJECT_TYPE_FUNCTION) {
+        object_init(result, OBJECT_TYPE_UNIT);
+        return true;
+    }
+
+    CHECK_EVAL(run_body(&func, &func_env_obj->env, result));
+    finish_call(result, func_env_obj, &func);
+
+    return true;
+}
+
+// calls a bound or composed function, which takes its arguments already
+// evaluated
+static bool eval_derived_call(const expr *call_expr, object *func, environment *env,
+                              object *result) {
+    size_t argc = arg_count(call_expr);
+    object args[argc + 1];
+
+    const expr *call_param = first_arg(call_expr);
+    for (size_t i = 0; i < argc; ++i) {
+        CHECK_EVAL(eval(call_param, env, args + i));
+        call_param = next_arg(call_expr, call_param);
+    }
+
+    CHECK_EVAL(apply_function(func, args, argc, call_expr, env, result));
+    temp_cleanup(func);
+
+    return true;
+}
+
+// builtins evaluate their own arguments, evaluated ones are given to them
+// as argument nodes
+static bool apply_builtin(const object *func, object *args, size_t argc, const expr *call_expr,
+                          environment *env, object *result) {
+    expr arg_exprs[argc + 1];
+    expr_list params = {0};
+
+    for (size_t i = 0; i < argc; ++i) {
+        arg_exprs[i] = (expr){
+            .start_tok = call_expr->start_tok,
+            .end_tok = call_expr->end_tok,
+            .type = EXPR_TYPE_ARGUMENT,
+            .value = args + i,
+        };
+        el_append(&params, arg_exprs + i);
+    }
+
+    CHECK_EVAL(func->builtin_fn(&params, call_expr, env, result));
+
+    // the result may refer into an argument that dies with the call
+    if (result->type == OBJECT_TYPE_LVALUE) {
+        copy_obj(result, result->ref);
+        temp_retain(result);
+    }
+
+    return true;
+}
+
+// calls func, which passed check_call, with argc evaluated arguments that
+// are taken over by its parameters. Bound arguments are prepended and
+// composed functions call one function with the result of the other, so
+// none of them needs a call expression of its own
+bool apply_function(const object *func, object *args, size_t argc, const expr *call_expr,
+                    environment *env, object *result) {
+    switch (func->kind) {
+        case FUNCTION_KIND_BUILTIN: {
+            CHECK_EVAL(apply_builtin(func, args, argc, call_expr, env, result));
+        } break;
+        case FUNCTION_KIND_NORMAL: {
+            if (eval_stack_exhausted()) {
+                stack_overflow_error(call_expr);
+                return false;
+            }
+
+            object *func_env_obj = new_frame(func, env);
+
+            const expr *func_param = func->params.head;
+            for (size_t i = 0; i < argc; ++i) {
+                CHECK_EVAL(bind_param(func_param, args + i, call_expr, &func_env_obj->env));
+                func_param = func_param->next;
+            }
+
+            CHECK_EVAL(run_body(func, &func_env_obj->env, result));
+
+            if (result->type == OBJECT_TYPE_LVALUE) {
+                copy_obj(result, result->ref);
+                temp_retain(result);
+            }
+
+            rc_dec(func_env_obj);
+        } break;
+        case FUNCTION_KIND_BOUND: {
+            object bound_args[argc + 1];
+
+            bound_args[0] = (object){
+                .type = OBJECT_TYPE_LVALUE,
+                .ref = slot_obj((object_slot *)&func->bound_arg),
+            };
+            memcpy(bound_args + 1, args, argc * sizeof(object));
+
+            const object *callee = slot_obj((object_slot *)&func->callee);
+            CHECK_EVAL(apply_function(callee, bound_args, argc + 1, call_expr, env, result));
+        } break;
+        case FUNCTION_KIND_COMPOSED: {
+            const object *inner = slot_obj((object_slot *)&func->inner);
+            const object *callee = slot_obj((object_slot *)&func->callee);
+
+            object inner_result;
+            CHECK_EVAL(apply_function(inner, args, argc, call_expr, env, &inner_result));
+            CHECK_EVAL(apply_function(callee, &inner_result, 1, call_expr, env, result));
+        } break;
+        default: {
+            generic_error(call_expr, "How did we get here?");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// checks that func can be called with the arguments of call_expr
+bool check_call(const expr *call_expr, const object *func) {
+    if (func->type != OBJECT_TYPE_FUNCTION) {
         generic_error(call_expr, "'%s' object is not callable, expected function",
-                      object_type_literals[func.type]);
+                      object_type_literals[func->type]);
         return false;
     }
 
-    size_t expected_params = fn_param_count(&func);
-    size_t actual_params = call_expr->params.size;
+    if (func->kind == FUNCTION_KIND_BUILTIN && is_method_call(call_expr)) {
+        generic_error(call_expr, "Builtin functions cannot be called as methods");
+        return false;
+    }
+
+    size_t expected_params = fn_param_count(func);
+    size_t actual_params = arg_count(call_expr);
 
     if (expected_params > actual_params) {
         generic_error(call_expr,
@@ -567,67 +928,185 @@ static bool eval_call_expression(const expr *call_expr, environment *env, object
         return false;
     }
 
-    if (func.builtin) {
-        return func.builtin_fn(&call_expr->params, call_expr, env, result);
+    return true;
+}
+
+void stack_overflow_error(const expr *e) {
+    generic_error(e, "Stack overflow (call depth %zu)", call_depth);
+}
+
+// whether call_expr was quickened for func, which then passed check_call
+// when it was first seen
+bool is_known_call(const expr *call_expr, const object *func) {
+    return call_expr->quick == QUICK_CLOSURE &&
+           func->type == OBJECT_TYPE_FUNCTION &&
+           func->kind == FUNCTION_KIND_NORMAL &&
+           func->layout == call_expr->known_layout &&
+           func->params.head == call_expr->known_params &&
+           func->params.size == arg_count(call_expr);
+}
+
+// quickens a call to func, which passed check_call. Only functions whose
+// parameters are plain identifiers taking the first slots of their frame
+// are known, those are bound with bind_known_param
+bool quicken_call(const expr *call_expr, const object *func) {
+    if (call_expr->quick != QUICK_UNSEEN) {
+        set_quick(call_expr, QUICK_GENERIC);
+        return false;
     }
 
-    size_t parameter_count = expected_params;
+    if (func->kind != FUNCTION_KIND_NORMAL || func->layout == NULL) {
+        set_quick(call_expr, QUICK_GENERIC);
+        return false;
+    }
 
-    object *func_env_obj = new_obj(OBJECT_TYPE_ENVIRONMENT, 1);
+    uint32_t slot = 0;
+    for (const expr *param = func->params.head; slot < func->params.size; param = param->next) {
+        const expr *ident = param->type == EXPR_TYPE_PREFIX_EXPRESSION ? param->right : param;
 
-    environment *func_env = &func_env_obj->env;
-    environment_init(func_env, func.outer_env, env->ht, scope_counter++);
-    func_env->obj = func_env_obj;
+        if (ident->layout != func->layout || ident->depth != 0 || ident->slot != slot++) {
+            set_quick(call_expr, QUICK_GENERIC);
+            return false;
+        }
+    }
 
-    const expr *func_param = func.params.head;
-    const expr *call_param = call_expr->params.head;
+    expr *e = (expr *)call_expr;
+    e->known_layout = func->layout;
+    e->known_params = func->params.head;
+    e->quick = QUICK_CLOSURE;
 
-    bool is_const;
-    const expr *ident;
+    return true;
+}
 
-    object param_obj;
-    for (size_t i = 0; i < parameter_count; ++i) {
-        CHECK_EVAL(eval(call_param, env, &param_obj));
+// the environment of a call to the normal function func
+object *new_frame(const object *func, environment *env) {
+    gc_safepoint();
 
-        if (func_param->type == EXPR_TYPE_PREFIX_EXPRESSION) {
-            is_const = true;
-            ident = func_param->right;
-        } else {
-            is_const = false;
-            ident = func_param;
-        }
+    return env_new_frame(func->outer_env, env->ht, scope_counter++, func->layout);
+}
 
-        CHECK_EVAL(assign_lhs(ident, &param_obj, call_expr, func_env, is_const, NULL));
+bool bind_param(const expr *func_param, const object *arg, const expr *call_expr,
+                environment *func_env) {
+    bool is_const = func_param->type == EXPR_TYPE_PREFIX_EXPRESSION;
+    const expr *ident = is_const ? func_param->right : func_param;
 
-        func_param = func_param->next;
-        call_param = call_param->next;
-    }
+    return assign_lhs(ident, arg, call_expr, func_env, is_const, NULL);
+}
 
-    CHECK_EVAL(eval(func.body, func_env, result));
+// bind_param into the fresh frame of a known call
+bool bind_known_param(const expr *func_param, const object *arg, const expr *call_expr,
+                      environment *func_env) {
+    bool is_const = func_param->type == EXPR_TYPE_PREFIX_EXPRESSION;
+    const expr *ident = is_const ? func_param->right : func_param;
 
-    rc_dec(func_env_obj);
+    bool is_new_const;
+    object_slot new_slot;
+    resolve_assign_rhs(arg, &new_slot, &is_new_const);
+
+    if (is_new_const && !is_const) {
+        slot_release(&new_slot);
+        generic_error(call_expr, "Assigning const expression to mutable variable");
+        return false;
+    }
 
+    env_bind(func_env->slots + ident->slot, &new_slot, is_const);
     return true;
 }
 
+static inline bool run_code(const object *func, environment *func_env, object *result) {
+    if (func->code != NULL)
+        return vm_run(func->code, func_env, result);
+    return eval(func->body, func_env, result);
+}
+
+// runs the body of func in its frame, compiled when the vm compiled it.
+// Tail calls the walked body makes run here one after another, each frame
+// released as soon as the next call is bound, so loops written as tail
+// recursion run in constant stack
+bool run_body(const object *func, environment *func_env, object *result) {
+    bool ok = false;
+
+    ++call_depth;
+    if (!run_code(func, func_env, result))
+        goto out;
+
+    while (pending_tail.env_obj != NULL) {
+        object callee = pending_tail.func;
+        object *callee_env_obj = pending_tail.env_obj;
+        pending_tail.env_obj = NULL;
+
+        if (!run_code(&callee, &callee_env_obj->env, result))
+            goto out;
+
+        if (pending_tail.env_obj == NULL) {
+            finish_call(result, callee_env_obj, &callee);
+            break;
+        }
+
+        rc_dec(callee_env_obj);
+        temp_cleanup(&callee);
+    }
+
+    ok = true;
+out:
+    --call_depth;
+    return ok;
+}
+
+// releases what a call to func held once its body evaluated to result
+void finish_call(object *result, object *func_env_obj, object *func) {
+    // the result may refer to a local that dies with the environment
+    if (result->type == OBJECT_TYPE_LVALUE) {
+        copy_obj(result, result->ref);
+        temp_retain(result);
+    }
+
+    rc_dec(func_env_obj);
+    temp_cleanup(func);
+}
+
 static bool eval_index_expression(const expr *index_expr, environment *env, object *result) {
-    ol_iterator it;
+    return eval_index(index_expr, env, result, false);
+}
+
+// for_write unshares the list first, so the resulting lvalue can be
+// modified in place
+static bool eval_index(const expr *index_expr, environment *env, object *result, bool for_write) {
+    size_t idx;
     object list;
-    CHECK_EVAL(get_ie_it(index_expr, env, &it, &list));
+    CHECK_EVAL(get_ie_idx(index_expr, env, &idx, &list));
 
-    if (list.type == OBJECT_TYPE_LVALUE) {
+    if (for_write && list.type == OBJECT_TYPE_LVALUE) {
         object_init(result, OBJECT_TYPE_LVALUE);
-        result->ref = it.obj;
+        result->ref = slot_obj(ol_mut(&list.ref->values, idx));
         result->is_const = list.is_const;
-    } else {
-        *result = *it.obj;
-        temp_cleanup(&list);
+        return true;
     }
 
+    index_read(&list, idx, result);
     return true;
 }
 
-static bool eval_function_literal(const expr *function_literal, environment *env, object *result) {
+// reads item idx of an evaluated list, releasing the list if it is a
+// temporary
+void index_read(object *list, size_t idx, object *result) {
+    if (list->type == OBJECT_TYPE_LVALUE) {
+        ol_ref(&list->ref->values, idx, result);
+
+        if (result->type == OBJECT_TYPE_LVALUE)
+            result->is_const = list->is_const;
+        return;
+    }
+
+    ol_ref(&list->values, idx, result);
+    if (result->type == OBJECT_TYPE_LVALUE) {
+        copy_obj(result, result->ref);
+        temp_retain(result);
+    }
+    temp_cleanup(list);
+}
+
+bool eval_function_literal(const expr *function_literal, environment *env, object *result) {
     expr *params = function_literal->left;
     const expr *body = function_literal->right;
 
@@ -636,6 +1115,14 @@ static bool eval_function_literal(const expr *function_literal, environment *env
     CHECK_EVAL(eval_func_params(params, env, &result->params));
 
     result->body = body;
+    result->layout = function_literal->fn_layout;
+    result->code = function_literal->fn_code;
+
+    if (result->layout != NULL && result->layout->flat) {
+        result->outer_env = capture_env(result->layout, env);
+        return true;
+    }
+
     result->outer_env = env;
 
     if (env->obj != NULL)
@@ -644,49 +1131,82 @@ static bool eval_function_literal(const expr *function_literal, environment *env
     return true;
 }
 
-static bool eval_compose_expression(const expr *compose_expr, environment *env, object *result) {
-    expr *outer, *inner;
-    const token *start_tok, *end_tok;
+// the environment of a closure of the flat function with layout made in
+// the frame env, counted for the closure. It holds only the variables the
+// function captures, made in the top level the frame itself was made in
+static environment *capture_env(const frame_layout *layout, environment *env) {
+    environment *top = env->layout->captures != NULL ? env->outer->outer : env->outer;
+    frame_layout *captures = layout->captures;
 
-    switch (compose_expr->op.type) {
-        case TOKEN_TYPE_LEFT_COMPOSE: {
-            outer = compose_expr->left;
-            inner = compose_expr->right;
+    if (captures == NULL) {
+        if (top->obj != NULL)
+            ++top->obj->rc;
+        return top;
+    }
 
-            start_tok = &outer->start_tok;
-            end_tok = &inner->end_tok;
-        } break;
-        case TOKEN_TYPE_RIGHT_COMPOSE: {
-            outer = compose_expr->right;
-            inner = compose_expr->left;
+    object *captured_obj = new_obj(OBJECT_TYPE_ENVIRONMENT, 1);
+    environment *captured = &captured_obj->env;
 
-            start_tok = &inner->start_tok;
-            end_tok = &outer->end_tok;
-        } break;
-        default: {
-            generic_error(compose_expr, "How did we get here?");
-            return false;
-        }
+    environment_init(captured, top, env->ht, scope_counter++, captures);
+    captured->obj = captured_obj;
+
+    for (size_t i = 0; i < captures->size; ++i) {
+        capture_source from = layout->capture_from[i];
+        environment *source = from.outer ? env->outer : env;
+
+        env_capture(captured->slots + i, source->slots + from.slot);
     }
 
+    return captured;
+}
+
+// the operands of a composition, outer applied to the result of inner
+static inline void compose_operands(const expr *compose_expr, const expr **outer,
+                                    const expr **inner) {
+    bool left = compose_expr->op.type == TOKEN_TYPE_LEFT_COMPOSE;
+    *outer = left ? compose_expr->left : compose_expr->right;
+    *inner = left ? compose_expr->right : compose_expr->left;
+}
+
+static bool eval_compose_expression(const expr *compose_expr, environment *env, object *result) {
+    const expr *outer, *inner;
+    compose_operands(compose_expr, &outer, &inner);
+
     object outer_fn, inner_fn;
 
-    CHECK_EVAL(eval_no_l(outer, env, &outer_fn));
-    CHECK_EVAL(eval_no_l(inner, env, &inner_fn));
+    CHECK_EVAL(eval(outer, env, &outer_fn));
+    CHECK_EVAL(eval(inner, env, &inner_fn));
+
+    return compose_values(compose_expr, &outer_fn, &inner_fn, result);
+}
+
+// composes the evaluated operands of compose_expr, taking them over
+bool compose_values(const expr *compose_expr, object *outer_fn, object *inner_fn,
+                    object *result) {
+    const expr *outer, *inner;
+    compose_operands(compose_expr, &outer, &inner);
+
+    const object *outer_val = outer_fn->type == OBJECT_TYPE_LVALUE ? outer_fn->ref : outer_fn;
+    const object *inner_val = inner_fn->type == OBJECT_TYPE_LVALUE ? inner_fn->ref : inner_fn;
 
-    if (outer_fn.type != OBJECT_TYPE_FUNCTION) {
-        generic_error(outer, "'%s' object is composable, expected function",
-                      object_type_literals[outer_fn.type]);
+    if (outer_val->type != OBJECT_TYPE_FUNCTION) {
+        generic_error(outer, "'%s' object is not composable, expected function",
+                      object_type_literals[outer_val->type]);
         return false;
     }
 
-    if (inner_fn.type != OBJECT_TYPE_FUNCTION) {
+    if (inner_val->type != OBJECT_TYPE_FUNCTION) {
         generic_error(inner, "'%s' object is not composable, expected function",
-                      object_type_literals[inner_fn.type]);
+                      object_type_literals[inner_val->type]);
         return false;
     }
 
-    size_t outer_param_count = fn_param_count(&outer_fn);
+    if (outer_val->kind == FUNCTION_KIND_BUILTIN || inner_val->kind == FUNCTION_KIND_BUILTIN) {
+        generic_error(compose_expr, "Builtin functions cannot be composed");
+        return false;
+    }
+
+    size_t outer_param_count = fn_param_count(outer_val);
 
     if (outer_param_count != 1) {
         generic_error(outer, "Outer function in composition must have 1 parameter, got %zu",
@@ -695,92 +1215,70 @@ static bool eval_compose_expression(const expr *compose_expr, environment *env,
     }
 
     object_init(result, OBJECT_TYPE_FUNCTION);
-    result->params = inner_fn.params;
-    result->outer_env = env;
-
-    expr *inner_call = new_expr3(EXPR_TYPE_CALL_EXPRESSION, start_tok, end_tok);
-    expr *outer_call = new_expr3(EXPR_TYPE_CALL_EXPRESSION, start_tok, end_tok);
-
-    inner_call->function = inner;
-    inner_call->params = inner_fn.params;
+    result->kind = FUNCTION_KIND_COMPOSED;
 
-    outer_call->function = outer;
-    outer_call->params = (expr_list){
-        .head = inner_call,
-        .tail = inner_call,
-        .size = 1,
-    };
-
-    result->body = outer_call;
+    slot_store(&result->callee, outer_fn);
+    slot_store(&result->inner, inner_fn);
 
     return true;
 }
 
+// the function and the argument of a pipe or of a dot outside a call
+static inline void pipe_operands(const expr *pipe_expr, const expr **fn, const expr **param) {
+    bool left = pipe_expr->op.type == TOKEN_TYPE_LEFT_PIPE;
+    *fn = left ? pipe_expr->left : pipe_expr->right;
+    *param = left ? pipe_expr->right : pipe_expr->left;
+}
+
 static bool eval_pipe_expression(const expr *pipe_expr, environment *env, object *result) {
-    expr *fn, *param;
-    const token *start_tok, *end_tok;
+    const expr *fn, *param;
+    pipe_operands(pipe_expr, &fn, &param);
 
-    switch (pipe_expr->op.type) {
-        case TOKEN_TYPE_LEFT_PIPE: {
-            fn = pipe_expr->left;
-            param = pipe_expr->right;
+    object fn_obj;
 
-            start_tok = &fn->start_tok;
-            end_tok = &param->end_tok;
-        } break;
-        case TOKEN_TYPE_DOT:
-        case TOKEN_TYPE_RIGHT_PIPE: {
-            fn = pipe_expr->right;
-            param = pipe_expr->left;
+    CHECK_EVAL(eval(fn, env, &fn_obj));
+    CHECK_EVAL(check_pipe(pipe_expr, &fn_obj));
 
-            start_tok = &param->start_tok;
-            end_tok = &fn->end_tok;
-        } break;
-        default: {
-            generic_error(pipe_expr, "How did we get here?");
-            return false;
-        }
-    }
+    object param_obj;
+    CHECK_EVAL(eval(param, env, &param_obj));
 
-    object fn_obj;
+    bind_arg(&fn_obj, &param_obj, result);
+    return true;
+}
+
+// checks the evaluated function of pipe_expr before its argument is evaluated
+bool check_pipe(const expr *pipe_expr, const object *fn_obj) {
+    const expr *fn, *param;
+    pipe_operands(pipe_expr, &fn, &param);
 
-    CHECK_EVAL(eval_no_l(fn, env, &fn_obj));
+    const object *fn_val = fn_obj->type == OBJECT_TYPE_LVALUE ? fn_obj->ref : fn_obj;
 
-    if (fn_obj.type != OBJECT_TYPE_FUNCTION) {
+    if (fn_val->type != OBJECT_TYPE_FUNCTION) {
         generic_error(fn, "'%s' object cannot be piped into, expected function",
-                      object_type_literals[fn_obj.type]);
+                      object_type_literals[fn_val->type]);
         return false;
     }
 
-    size_t param_count = fn_param_count(&fn_obj);
+    if (fn_val->kind == FUNCTION_KIND_BUILTIN) {
+        generic_error(fn, "Cannot pipe into builtin function");
+        return false;
+    }
 
-    if (param_count < 1) {
+    if (fn_param_count(fn_val) < 1) {
         generic_error(pipe_expr, "Cannot pipe into function with 0 arguments");
         return false;
     }
 
-    object_init(result, OBJECT_TYPE_FUNCTION);
-    result->params = (expr_list){
-        .head = fn_obj.params.head->next,
-        .tail = fn_obj.params.tail,
-        .size = param_count - 1,
-    };
-
-    param->next = fn_obj.params.head->next;
-
-    expr *call = new_expr3(EXPR_TYPE_CALL_EXPRESSION, start_tok, end_tok);
-    call->function = fn;
-    call->params = (expr_list){
-        .head = param,
-        .tail = fn_obj.params.tail,
-        .size = param_count,
-    };
-
-    result->body = call;
+    return true;
+}
 
-    result->outer_env = env;
+// binds param_obj as the first argument of fn_obj, taking both over
+void bind_arg(object *fn_obj, object *param_obj, object *result) {
+    object_init(result, OBJECT_TYPE_FUNCTION);
+    result->kind = FUNCTION_KIND_BOUND;
 
-    return true;
+    slot_store(&result->callee, fn_obj);
+    slot_store(&result->bound_arg, param_obj);
 }
 
 static bool eval_case_expression(const expr *case_expr, environment *env, object *result) {
@@ -795,7 +1293,10 @@ static bool eval_case_expression(const expr *case_expr, environment *env, object
     for (size_t i = 0; i < cases; ++i) {
         CHECK_EVAL(eval(condition_expr, env, &condition));
 
-        if (is_truthy(&condition)) {
+        bool truthy = is_truthy(&condition);
+        temp_cleanup(&condition);
+
+        if (truthy) {
             CHECK_EVAL(eval(result_expr, env, result));
             break;
         }
@@ -854,11 +1355,13 @@ static bool eval_import_expression(const expr *import_expr, environment *env, ob
 
             fn = new_obj(OBJECT_TYPE_FUNCTION, 1);
 
-            fn->builtin = true;
+            fn->kind = FUNCTION_KIND_BUILTIN;
             fn->builtin_param_count = entry->param_count;
             fn->builtin_fn = entry->fn;
 
-            env_set(env, entry->name, strlen(entry->name), fn, true);
+            object_slot fn_slot;
+            slot_set_ref(&fn_slot, fn);
+            env_set(env, intern(entry->name, strlen(entry->name)), &fn_slot, true);
         }
     } else {
         char *file_contents = read_file(file_name);
@@ -916,42 +1419,40 @@ static bool assign_lhs(const expr *lhs, const object *rhs, const expr *parent,
     return true;
 }
 
-static object *resolve_assign_rhs(const object *rhs, bool *is_const) {
-    object *new_obj;
+// stores rhs in slot, is_const is set when slot ends up sharing a const
+// heap object
+static void resolve_assign_rhs(const object *rhs, object_slot *slot, bool *is_const) {
+    slot_store(slot, rhs);
 
-    if (rhs->type == OBJECT_TYPE_LVALUE) {
-        if (copy_by_value(rhs->ref->type)) {
-            new_obj = new_copied_obj(rhs->ref);
-            new_obj->rc = 1;
-            if (is_const)
-                *is_const = false;
-        } else {
-            new_obj = rhs->ref;
-            ++new_obj->rc;
-            if (is_const)
-                *is_const = rhs->is_const;
-        }
-    } else {
-        new_obj = new_copied_obj(rhs);
-        new_obj->rc = 1;
-        if (is_const)
-            *is_const = false;
+    if (is_const) {
+        *is_const = rhs->type == OBJECT_TYPE_LVALUE &&
+                    !is_inline_type(rhs->ref->type) &&
+                    rhs->is_const;
     }
-
-    return new_obj;
 }
 
 static bool assign_ident(const expr *ident, const object *rhs, const expr *parent,
                          environment *env, bool is_const, object **n_obj) {
     (void)parent;
 
-    const char *key = ident->literal;
-    size_t key_length = ident->length;
+    const symbol *key = ident->sym;
+
+    // identifiers being assigned to are resolved to the local frame
+    env_binding *binding = env_resolved(env, ident);
 
-    if (env_contains_local_scope(env, key, key_length)) {
+    if (binding != NULL && binding->is_bound) {
+        if (binding->is_const) {
+            generic_error(parent, "Assigning const expression");
+            return false;
+        }
+        if (is_const) {
+            generic_error(parent, "Assign mutable expression as const");
+            return false;
+        }
+    } else if (binding == NULL && env_contains_local_scope(env, key)) {
         object *old_obj;
         bool obj_is_const;
-        CHECK_EVAL(env_get(env, key, key_length, &old_obj, &obj_is_const));
+        CHECK_EVAL(env_get(env, key, &old_obj, &obj_is_const));
         if (obj_is_const) {
             generic_error(parent, "Assigning const expression");
             return false;
@@ -960,22 +1461,34 @@ static bool assign_ident(const expr *ident, const object *rhs, const expr *paren
             generic_error(parent, "Assign mutable expression as const");
             return false;
         }
-        rc_dec(old_obj);
     }
 
     bool is_new_const;
-    object *new_obj = resolve_assign_rhs(rhs, &is_new_const);
+    object_slot new_slot;
+    resolve_assign_rhs(rhs, &new_slot, &is_new_const);
 
     if (is_new_const && !is_const) {
+        slot_release(&new_slot);
         generic_error(parent, "Assigning const expression to mutable variable");
         return false;
     }
 
+    // replaces and releases the old value
+    if (binding != NULL) {
+        env_bind(binding, &new_slot, is_const);
+
+        if (n_obj)
+            *n_obj = slot_obj(&binding->value);
+
+        return true;
+    }
+
+    env_set(env, key, &new_slot, is_const);
+
     if (n_obj) {
-        *n_obj = new_obj;
+        env_get(env, key, n_obj, NULL);
     }
 
-    env_set(env, key, key_length, new_obj, is_const);
     return true;
 }
 
@@ -1014,16 +1527,14 @@ static bool assign_list(const expr *list, const object *rhs, const expr *parent,
     size_t value_count = lhs_values->size;
 
     const expr *cur_lhs_expr = lhs_values->head;
-    ol_iterator rhs_it = ol_start(rhs_values);
 
     object lval;
     object_init(&lval, OBJECT_TYPE_LVALUE);
     for (size_t i = 0; i < value_count; ++i) {
-        lval.ref = rhs_it.obj;
+        ol_ref(rhs_values, i, &lval);
         CHECK_EVAL(assign_lhs(cur_lhs_expr, &lval, parent, env, is_const, NULL));
 
         cur_lhs_expr = cur_lhs_expr->next;
-        oli_next(&rhs_it);
     }
 
     if (new_obj) {
@@ -1040,9 +1551,9 @@ static bool assign_index(const expr *index_expr, const object *rhs, const expr *
         return false;
     }
 
-    ol_iterator it;
+    size_t idx;
     object list;
-    CHECK_EVAL(get_ie_it(index_expr, env, &it, &list));
+    CHECK_EVAL(get_ie_idx(index_expr, env, &idx, &list));
 
     if (list.type != OBJECT_TYPE_LVALUE) {
         generic_error(index_expr, "Expression is not assignable");
@@ -1054,18 +1565,17 @@ static bool assign_index(const expr *index_expr, const object *rhs, const expr *
         return false;
     }
 
-    object *old_obj = it.obj;
-    rc_dec(old_obj);
-
     bool is_new_const;
-    object *new_obj = resolve_assign_rhs(rhs, &is_new_const);
+    object_slot new_slot;
+    resolve_assign_rhs(rhs, &new_slot, &is_new_const);
 
     if (is_new_const && !is_const) {
+        slot_release(&new_slot);
         generic_error(parent, "Assigning const expression to mutable variable");
         return false;
     }
 
-    it.ln->value = new_obj;
+    object *new_obj = ol_set(&list.ref->values, idx, &new_slot);
 
     if (n_obj)
         *n_obj = new_obj;
@@ -1114,24 +1624,12 @@ static bool assign_prepend(const expr *lhs, const object *rhs, const expr *paren
         generic_error(parent, "Cannot prepend unpack list of size 0");
         return false;
     }
-    ol_iterator rhs_it = ol_start(rhs_values);
-    object lval = {
-        .type = OBJECT_TYPE_LVALUE,
-        .ref = rhs_it.obj,
-    };
+    object lval;
+    ol_ref(rhs_values, 0, &lval);
     CHECK_EVAL(assign_lhs(left, &lval, parent, env, is_const, NULL));
 
-    oli_next(&rhs_it);
-    if (!oli_is_end(&rhs_it))
-        ++rhs_it.ln->rc;
-
     object *rest = new_obj(OBJECT_TYPE_LIST, 1);
-
-    rest->values = (object_list){
-        .head = rhs_it.ln,
-        .tail = rhs_values->tail,
-        .size = rhs_values->size - 1,
-    };
+    ol_slice(&rest->values, rhs_values, 1);
 
     lval = (object){
         .type = OBJECT_TYPE_LVALUE,
@@ -1149,23 +1647,19 @@ static bool assign_prepend(const expr *lhs, const object *rhs, const expr *paren
 static bool assign_tuple_list(const expr *tuple_expr, const object_list *rhs, const expr *parent,
                               environment *env, bool is_const) {
     size_t size = rhs->size;
-    ol_iterator rhs_it = ol_start(rhs);
 
     const expr *left = tuple_expr->left;
     const expr *right = tuple_expr->right;
 
     object lval;
-    object_init(&lval, OBJECT_TYPE_LVALUE);
 
     size_t i = 0;
-    for (; !oli_is_end(&rhs_it); oli_next(&rhs_it), ++i) {
-        lval.ref = rhs_it.obj;
+    for (; i < size; ++i) {
+        ol_ref(rhs, i, &lval);
         CHECK_EVAL(assign_lhs(left, &lval, parent, env, is_const, NULL));
 
-        if (!is_tuple_exp(right)) {
-            oli_next(&rhs_it);
+        if (!is_tuple_exp(right))
             break;
-        }
 
         left = right->left;
         right = right->right;
@@ -1185,21 +1679,24 @@ static bool assign_tuple_list(const expr *tuple_expr, const object_list *rhs, co
         return false;
     }
 
-    lval.ref = rhs_it.obj;
+    ol_ref(rhs, i + 1, &lval);
     CHECK_EVAL(assign_lhs(right, &lval, parent, env, is_const, NULL));
     return true;
 }
 
-static inline bool get_ie_it(const expr *index_expression, environment *env, ol_iterator *oli,
-                             object *list) {
+static inline bool get_ie_idx(const expr *index_expression, environment *env, size_t *idx,
+                              object *list) {
     CHECK_EVAL(eval(index_expression->list, env, list));
+    CHECK_EVAL(check_subscriptable(index_expression, list));
 
-    object *l;
-    if (list->type == OBJECT_TYPE_LVALUE) {
-        l = list->ref;
-    } else {
-        l = list;
-    }
+    object index_obj;
+    CHECK_EVAL(eval_no_l(index_expression->index, env, &index_obj));
+
+    return check_index(index_expression, list, &index_obj, idx);
+}
+
+bool check_subscriptable(const expr *index_expression, const object *list) {
+    const object *l = list->type == OBJECT_TYPE_LVALUE ? list->ref : list;
 
     if (l->type != OBJECT_TYPE_LIST) {
         generic_error(index_expression, "'%s' object is not subscriptable, expected list",
@@ -1207,17 +1704,23 @@ static inline bool get_ie_it(const expr *index_expression, environment *env, ol_
         return false;
     }
 
-    object index_obj;
-    CHECK_EVAL(eval_no_l(index_expression->index, env, &index_obj));
+    return true;
+}
 
-    if (index_obj.type != OBJECT_TYPE_INT) {
+// checks index_obj is in bounds for the subscriptable list and stores it
+// in idx
+bool check_index(const expr *index_expression, const object *list, const object *index_obj,
+                 size_t *idx) {
+    const object *l = list->type == OBJECT_TYPE_LVALUE ? list->ref : list;
+
+    if (index_obj->type != OBJECT_TYPE_INT) {
         generic_error(index_expression->index, "Invalid index type, expected int");
         return false;
     }
 
-    object_list *values = &l->values;
+    const object_list *values = &l->values;
 
-    int64_t index_value = index_obj.int_value;
+    int64_t index_value = index_obj->int_value;
 
     if (index_value < 0) {
         generic_error(index_expression->index, "Negative index value: %lld", index_value);
@@ -1230,9 +1733,7 @@ static inline bool get_ie_it(const expr *index_expression, environment *env, ol_
         return false;
     }
 
-    *oli = ol_start(values);
-
-    for (int64_t i = 0; i < index_value; ++i, oli_next(oli));
+    *idx = (size_t)index_value;
 
     return true;
 }
@@ -1275,7 +1776,7 @@ static inline bool valid_infix_num_types(const object *left, const object *right
     return is_num_type(left) && is_num_type(right);
 }
 
-static inline bool is_truthy(const object *obj) {
+bool is_truthy(const object *obj) {
     switch (obj->type) {
         case OBJECT_TYPE_INT:
             return obj->int_value != 0;
@@ -1302,10 +1803,6 @@ static inline bool is_tuple_exp(const expr *e) {
     return e->op.type == TOKEN_TYPE_COMMA;
 }
 
-static inline bool copy_by_value(object_type ot) {
-    return ot == OBJECT_TYPE_INT || ot == OBJECT_TYPE_FLOAT || ot == OBJECT_TYPE_CHAR;
-}
-
 static inline void undefined_var_error(const expr *e) {
     const token *tok = &e->start_tok;
     generic_error(e, "Variable not in scope: %.*s", (int)tok->length, tok->literal);
@@ -1321,10 +1818,6 @@ static inline void generic_error(const expr *e, const char *msg, ...) {
     va_end(vargs);
 }
 
-static inline size_t fn_param_count(const object *fn) {
-    return fn->builtin ? fn->builtin_param_count : fn->params.size;
-}
-
 void add_cmdline_args(char **args, size_t argc, environment *env) {
     object *arg_list = new_obj(OBJECT_TYPE_LIST, 1);
 
@@ -1336,17 +1829,16 @@ void add_cmdline_args(char **args, size_t argc, environment *env) {
         char *arg_literal = args[i];
         size_t arg_length = strlen(arg_literal);
 
-        object *char_obj;
-        for (size_t i = 0; i < arg_length; ++i) {
-            char_obj = new_obj(OBJECT_TYPE_CHAR, 1);
-            char_obj->char_value = arg_literal[i];
-            ol_append(&arg_obj->values, char_obj);
-        }
+        ol_init_str(&arg_obj->values, arg_literal, arg_length);
 
-        ol_append(arg_obj_list, arg_obj);
+        object_slot arg_slot;
+        slot_set_ref(&arg_slot, arg_obj);
+        ol_append(arg_obj_list, &arg_slot);
     }
 
-    env_set(env, ARGS_VAR_NAME, sizeof(ARGS_VAR_NAME) - 1, arg_list, true);
+    object_slot arg_list_slot;
+    slot_set_ref(&arg_list_slot, arg_list);
+    env_set(env, intern(ARGS_VAR_NAME, sizeof(ARGS_VAR_NAME) - 1), &arg_list_slot, true);
 }
 
 static bool builtin_println(const expr_list *params, const expr *call, environment *env, object *result) {
@@ -1361,6 +1853,9 @@ static bool builtin_println(const expr_list *params, const expr *call, environme
 
     printf("%.*s\n", (int)sb.size, sb.store);
 
+    sb_free(&sb);
+    temp_cleanup(&o);
+
     object_init(result, OBJECT_TYPE_UNIT);
     return true;
 }
@@ -1380,6 +1875,8 @@ static bool builtin_len(const expr_list *params, const expr *call, environment *
     object_init(result, OBJECT_TYPE_INT);
     result->int_value = (int64_t)list.values.size;
 
+    temp_cleanup(&list);
+
     return true;
 }
 
@@ -1400,12 +1897,7 @@ static bool builtin_head(const expr_list *params, const expr *call, environment
         return false;
     }
 
-    object *head_value = list.values.head->value;
-
-    *result = (object){
-        .type = OBJECT_TYPE_LVALUE,
-        .ref = head_value,
-    };
+    ol_ref(&list.values, 0, result);
 
     return true;
 }
@@ -1428,11 +1920,9 @@ static bool builtin_tail(const expr_list *params, const expr *call, environment
     }
 
     object_init(result, OBJECT_TYPE_LIST);
-    result->values = (object_list){
-        .head = list.values.head->next,
-        .tail = list.values.tail,
-        .size = list.values.size - 1,
-    };
+    ol_slice(&result->values, &list.values, 1);
+
+    temp_cleanup(&list);
 
     return true;
 }
@@ -1440,28 +1930,264 @@ static bool builtin_tail(const expr_list *params, const expr *call, environment
 static bool builtin_copy(const expr_list *params, const expr *call, environment *env, object *result) {
     (void)call;
 
-    const expr *list_expr = params->head;
+    // a list shares the store of the one it copies, whichever writes to
+    // it first copies it
+    return eval_no_l(params->head, env, result);
+}
 
-    object obj;
-    CHECK_EVAL(eval_no_l(list_expr, env, &obj));
+// The calls a list builtin makes to the function it was given, one for
+// each item. A function whose frames never outlive its calls runs all of
+// them in one frame, its variables unbound in between
+typedef struct {
+    const object *func;
+    const expr *call;
+    environment *env;
+    object *frame;  // NULL until the first call, or when each call gets its own
+} item_calls;
+
+static inline bool reuses_frame(const object *func) {
+    return func->kind == FUNCTION_KIND_NORMAL && func->layout != NULL && !func->layout->escapes;
+}
 
-    if (obj.type == OBJECT_TYPE_LIST) {
-        object_init(result, OBJECT_TYPE_LIST);
+static bool start_calls(item_calls *calls, const char *name, const object *func,
+                        size_t param_count, const expr *call, environment *env) {
+    if (func->type != OBJECT_TYPE_FUNCTION) {
+        generic_error(call, "%s expected function, got %s", name,
+                      object_type_literals[func->type]);
+        return false;
+    }
 
-        ol_iterator it = ol_start(&obj.values);
-        for (; !oli_is_end(&it); oli_next(&it)) {
-            object *to_append;
-            if (copy_by_value(it.obj->type)) {
-                to_append = new_empty_obj();
-                *to_append = *it.obj;
-            } else {
-                to_append = it.obj;
-                ++to_append->rc;
-            }
-            ol_append(&result->values, to_append);
+    if (fn_param_count(func) != param_count) {
+        generic_error(call, "%s expected function with %zu parameters, got %zu", name,
+                      param_count, fn_param_count(func));
+        return false;
+    }
+
+    *calls = (item_calls){
+        .func = func,
+        .call = call,
+        .env = env,
+    };
+
+    return true;
+}
+
+// calls the function with argc arguments it takes over, the result is
+// never an lvalue
+static bool call_item(item_calls *calls, object *args, size_t argc, object *result) {
+    const object *func = calls->func;
+
+    if (!reuses_frame(func))
+        return apply_function(func, args, argc, calls->call, calls->env, result);
+
+    if (calls->frame == NULL) {
+        if (eval_stack_exhausted()) {
+            stack_overflow_error(calls->call);
+            return false;
         }
+
+        calls->frame = new_frame(func, calls->env);
     } else {
-        *result = obj;
+        gc_safepoint();
+        env_reset_frame(&calls->frame->env);
+    }
+
+    environment *func_env = &calls->frame->env;
+
+    const expr *func_param = func->params.head;
+    for (size_t i = 0; i < argc; ++i, func_param = func_param->next) {
+        CHECK_EVAL(bind_param(func_param, args + i, calls->call, func_env));
+    }
+
+    CHECK_EVAL(run_body(func, func_env, result));
+
+    if (result->type == OBJECT_TYPE_LVALUE) {
+        copy_obj(result, result->ref);
+        temp_retain(result);
+    }
+
+    return true;
+}
+
+static void end_calls(item_calls *calls) {
+    rc_dec(calls->frame);
+}
+
+// evaluates the list argument of the builtin name
+static bool eval_list_arg(const char *name, const expr *list_expr, const expr *call,
+                          environment *env, object *list) {
+    CHECK_EVAL(eval_no_l(list_expr, env, list));
+
+    if (list->type != OBJECT_TYPE_LIST) {
+        generic_error(call, "%s expected list, got %s", name, object_type_literals[list->type]);
+        return false;
+    }
+
+    return true;
+}
+
+static bool builtin_map(const expr_list *params, const expr *call, environment *env, object *result) {
+    const expr *list_expr = params->head;
+    const expr *func_expr = list_expr->next;
+
+    object list, func;
+    CHECK_EVAL(eval_list_arg("map", list_expr, call, env, &list));
+    CHECK_EVAL(eval_no_l(func_expr, env, &func));
+
+    item_calls calls;
+    CHECK_EVAL(start_calls(&calls, "map", &func, 1, call, env));
+
+    object_init(result, OBJECT_TYPE_LIST);
+    ol_reserve(&result->values, list.values.size);
+
+    object item, value;
+    object_slot value_slot;
+    for (size_t i = 0; i < list.values.size; ++i) {
+        ol_ref(&list.values, i, &item);
+        CHECK_EVAL(call_item(&calls, &item, 1, &value));
+
+        resolve_assign_rhs(&value, &value_slot, NULL);
+        ol_append(&result->values, &value_slot);
+    }
+
+    end_calls(&calls);
+    temp_cleanup(&func);
+    temp_cleanup(&list);
+
+    return true;
+}
+
+static bool builtin_filter(const expr_list *params, const expr *call, environment *env, object *result) {
+    const expr *list_expr = params->head;
+    const expr *func_expr = list_expr->next;
+
+    object list, func;
+    CHECK_EVAL(eval_list_arg("filter", list_expr, call, env, &list));
+    CHECK_EVAL(eval_no_l(func_expr, env, &func));
+
+    item_calls calls;
+    CHECK_EVAL(start_calls(&calls, "filter", &func, 1, call, env));
+
+    object_init(result, OBJECT_TYPE_LIST);
+
+    object item, keep;
+    object_slot item_slot;
+    for (size_t i = 0; i < list.values.size; ++i) {
+        ol_ref(&list.values, i, &item);
+        CHECK_EVAL(call_item(&calls, &item, 1, &keep));
+
+        bool truthy = is_truthy(&keep);
+        temp_cleanup(&keep);
+
+        if (truthy) {
+            resolve_assign_rhs(&item, &item_slot, NULL);
+            ol_append(&result->values, &item_slot);
+        }
+    }
+
+    end_calls(&calls);
+    temp_cleanup(&func);
+    temp_cleanup(&list);
+
+    return true;
+}
+
+// calls the function with what the previous call returned, starting from
+// init, and each item
+static bool builtin_fold(const expr_list *params, const expr *call, environment *env, object *result) {
+    const expr *list_expr = params->head;
+    const expr *init_expr = list_expr->next;
+    const expr *func_expr = init_expr->next;
+
+    object list, func;
+    CHECK_EVAL(eval_list_arg("fold", list_expr, call, env, &list));
+    CHECK_EVAL(eval_no_l(init_expr, env, result));
+    CHECK_EVAL(eval_no_l(func_expr, env, &func));
+
+    item_calls calls;
+    CHECK_EVAL(start_calls(&calls, "fold", &func, 2, call, env));
+
+    object args[2];
+    for (size_t i = 0; i < list.values.size; ++i) {
+        args[0] = *result;
+        ol_ref(&list.values, i, args + 1);
+        CHECK_EVAL(call_item(&calls, args, 2, result));
+    }
+
+    end_calls(&calls);
+    temp_cleanup(&func);
+    temp_cleanup(&list);
+
+    return true;
+}
+
+// pairs up the items of two lists, as long as the shorter one
+static bool builtin_zip(const expr_list *params, const expr *call, environment *env, object *result) {
+    const expr *left_expr = params->head;
+    const expr *right_expr = left_expr->next;
+
+    object left, right;
+    CHECK_EVAL(eval_list_arg("zip", left_expr, call, env, &left));
+    CHECK_EVAL(eval_list_arg("zip", right_expr, call, env, &right));
+
+    size_t size = left.values.size < right.values.size ? left.values.size : right.values.size;
+
+    object_init(result, OBJECT_TYPE_LIST);
+    ol_reserve(&result->values, size);
+
+    object item, pair;
+    object_slot slot;
+    for (size_t i = 0; i < size; ++i) {
+        object_init(&pair, OBJECT_TYPE_LIST);
+        ol_reserve(&pair.values, 2);
+
+        ol_ref(&left.values, i, &item);
+        resolve_assign_rhs(&item, &slot, NULL);
+        ol_append(&pair.values, &slot);
+
+        ol_ref(&right.values, i, &item);
+        resolve_assign_rhs(&item, &slot, NULL);
+        ol_append(&pair.values, &slot);
+
+        resolve_assign_rhs(&pair, &slot, NULL);
+        ol_append(&result->values, &slot);
+    }
+
+    temp_cleanup(&left);
+    temp_cleanup(&right);
+
+    return true;
+}
+
+// the ints from start up to, but not including, end
+static bool builtin_range(const expr_list *params, const expr *call, environment *env, object *result) {
+    const expr *start_expr = params->head;
+    const expr *end_expr = start_expr->next;
+
+    object start, end;
+    CHECK_EVAL(eval_no_l(start_expr, env, &start));
+    CHECK_EVAL(eval_no_l(end_expr, env, &end));
+
+    if (start.type != OBJECT_TYPE_INT || end.type != OBJECT_TYPE_INT) {
+        generic_error(call, "range expected ints, got %s and %s",
+                      object_type_literals[start.type], object_type_literals[end.type]);
+        return false;
+    }
+
+    object_init(result, OBJECT_TYPE_LIST);
+
+    if (end.int_value <= start.int_value)
+        return true;
+
+    ol_reserve(&result->values, (size_t)(end.int_value - start.int_value));
+
+    object n = {
+        .type = OBJECT_TYPE_INT,
+    };
+    object_slot slot;
+    for (n.int_value = start.int_value; n.int_value < end.int_value; ++n.int_value) {
+        slot_store(&slot, &n);
+        ol_append(&result->values, &slot);
     }
 
     return true;
@@ -1488,53 +2214,24 @@ static bool builtin_foreach(const expr_list *params, const expr *call, environme
 
     CHECK_EVAL(eval_no_l(func_expr, env, &func));
 
-    if (func.type != OBJECT_TYPE_FUNCTION) {
-        generic_error(call, "foreach expected second argument to be function, got %s",
-                      object_type_literals[func.type]);
-        return false;
-    }
-
-    if (func.builtin) {
-        generic_error(call,
-                      "foreach does not support builtin functions as argument,"
-                      "use its normal variant instead");
-        return false;
-    }
-
-    size_t param_count = fn_param_count(&func);
-    if (param_count != 1) {
-        generic_error(call, "foreach expected function with one argument, got %zu",
-                      param_count);
-        return false;
-    }
-
-    const expr *func_param = func.params.head;
-
-    object param_obj, *new_entry;
-    ol_iterator it = ol_start(&list->values);
-    for (; !oli_is_end(&it); oli_next(&it)) {
-        object *func_env_obj = new_obj(OBJECT_TYPE_ENVIRONMENT, 1);
-
-        environment *func_env = &func_env_obj->env;
-        environment_init(func_env, func.outer_env, env->ht, scope_counter++);
-        func_env->obj = func_env_obj;
-
-        param_obj = (object){
-            .type = OBJECT_TYPE_LVALUE,
-            .ref = it.obj,
-        };
-        CHECK_EVAL(assign_lhs(func_param, &param_obj, call, func_env, false, NULL));
+    item_calls calls;
+    CHECK_EVAL(start_calls(&calls, "foreach", &func, 1, call, env));
 
-        new_entry = new_empty_obj();
-        CHECK_EVAL(eval(func.body, func_env, new_entry));
-        ++new_entry->rc;
+    object param_obj, entry;
+    object_slot new_entry;
 
-        rc_dec(func_env_obj);
+    // indexed since the function may append to the list and move its items
+    for (size_t i = 0; i < list->values.size; ++i) {
+        ol_ref(&list->values, i, &param_obj);
+        CHECK_EVAL(call_item(&calls, &param_obj, 1, &entry));
 
-        rc_dec(it.obj);
-        it.ln->value = new_entry;
+        resolve_assign_rhs(&entry, &new_entry, NULL);
+        ol_set(&list->values, i, &new_entry);
     }
 
+    end_calls(&calls);
+    temp_cleanup(&func);
+
     *result = list_maybe_l;
 
     return true;
@@ -1561,7 +2258,9 @@ static bool builtin_append(const expr_list *params, const expr *call, environmen
     object new_item;
     CHECK_EVAL(eval(new_item_expr, env, &new_item));
 
-    ol_append(&list->values, resolve_assign_rhs(&new_item, NULL));
+    object_slot new_slot;
+    resolve_assign_rhs(&new_item, &new_slot, NULL);
+    ol_append(&list->values, &new_slot);
 
     *result = list_maybe_l;
 
@@ -1608,29 +2307,22 @@ static bool builtin_remove(const expr_list *params, const expr *call, environmen
         return false;
     }
 
-    object *ln_to_remove;
-    if (idx_value == 0) {
-        ln_to_remove = list->values.head;
-
-        list->values.head = list->values.head->next;
-    } else {
-        ol_iterator it = ol_start(&list->values);
-
-        for (size_t i = 0; i < idx_value - 1; ++i, oli_next(&it));
+    ol_remove(&list->values, idx_value);
 
-        ln_to_remove = it.ln->next;
-        it.ln->next = ln_to_remove->next;
+    *result = list_maybe_l;
 
-        if (list->values.tail == ln_to_remove) {
-            list->values.tail = it.ln;
-        }
-    }
-    --list->values.size;
+    return true;
+}
 
-    ln_to_remove->next = NULL;
-    rc_dec(ln_to_remove);
+// frees the cycles left among unreachable objects, returns how many objects
+// were freed
+static bool builtin_gc(const expr_list *params, const expr *call, environment *env, object *result) {
+    (void)params;
+    (void)call;
+    (void)env;
 
-    *result = list_maybe_l;
+    object_init(result, OBJECT_TYPE_INT);
+    result->int_value = (int64_t)gc_collect();
 
     return true;
 }
@@ -1644,6 +2336,12 @@ static const builtin_entry builtin_fns[] = {
     {"__builtin_foreach", builtin_foreach, 2},
     {"__builtin_append", builtin_append, 2},
     {"__builtin_remove", builtin_remove, 2},
+    {"__builtin_map", builtin_map, 2},
+    {"__builtin_filter", builtin_filter, 2},
+    {"__builtin_fold", builtin_fold, 3},
+    {"__builtin_zip", builtin_zip, 2},
+    {"__builtin_range", builtin_range, 2},
+    {"__builtin_gc", builtin_gc, 0},
 };
 
 static const size_t builtin_count = sizeof(builtin_fns) / sizeof(builtin_entry);
@@ -1656,10 +2354,12 @@ void add_builtins(environment *env) {
 
         fn = new_obj(OBJECT_TYPE_FUNCTION, 1);
 
-        fn->builtin = true;
+        fn->kind = FUNCTION_KIND_BUILTIN;
         fn->builtin_param_count = entry->param_count;
         fn->builtin_fn = entry->fn;
 
-        env_set(env, entry->name, strlen(entry->name), fn, true);
+        object_slot fn_slot;
+        slot_set_ref(&fn_slot, fn);
+        env_set(env, intern(entry->name, strlen(entry->name)), &fn_slot, true);
     }
 }
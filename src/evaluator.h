@@ -10,4 +10,70 @@ void add_cmdline_args(char **args, size_t argc, environment *env);
 
 void add_builtins(environment *env);
 
+// calls being run, reset before each program
+extern size_t call_depth;
+
+void stack_overflow_error(const expr *e);
+
+// pieces of evaluation shared with the vm, operating on values that are
+// already evaluated
+
+WARN_UNUSED_RESULT
+bool eval_prefix_value(const expr *prefix_expr, object *result, object *og_result);
+
+WARN_UNUSED_RESULT
+bool eval_infix_values(const expr *infix_expr, object *left, object *right, object *result);
+
+WARN_UNUSED_RESULT
+bool eval_function_literal(const expr *function_literal, environment *env, object *result);
+
+WARN_UNUSED_RESULT
+bool compose_values(const expr *compose_expr, object *outer_fn, object *inner_fn,
+                    object *result);
+
+WARN_UNUSED_RESULT
+bool check_pipe(const expr *pipe_expr, const object *fn_obj);
+
+void bind_arg(object *fn_obj, object *param_obj, object *result);
+
+WARN_UNUSED_RESULT
+bool assign_value(const expr *assign_expr, object *right, environment *env, object *result);
+
+WARN_UNUSED_RESULT
+bool check_subscriptable(const expr *index_expression, const object *list);
+
+WARN_UNUSED_RESULT
+bool check_index(const expr *index_expression, const object *list, const object *index_obj,
+                 size_t *idx);
+
+void index_read(object *list, size_t idx, object *result);
+
+WARN_UNUSED_RESULT
+bool check_call(const expr *call_expr, const object *func);
+
+bool is_known_call(const expr *call_expr, const object *func);
+
+bool quicken_call(const expr *call_expr, const object *func);
+
+object *new_frame(const object *func, environment *env);
+
+WARN_UNUSED_RESULT
+bool bind_param(const expr *func_param, const object *arg, const expr *call_expr,
+                environment *func_env);
+
+WARN_UNUSED_RESULT
+bool bind_known_param(const expr *func_param, const object *arg, const expr *call_expr,
+                      environment *func_env);
+
+WARN_UNUSED_RESULT
+bool apply_function(const object *func, object *args, size_t argc, const expr *call_expr,
+                    environment *env, object *result);
+
+WARN_UNUSED_RESULT
+bool run_body(const object *func, environment *func_env, object *result);
+
+void finish_call(object *result, object *func_env_obj, object *func);
+
+bool is_truthy(const object *obj);
+
 #endif  // EVAULATOR_H
@@ -1,7 +1,24 @@
 #include "fixedalloc.h"
 
+#define WORD_BITS 64
+#define WORD_FULL (~(uint64_t)0)
+
+#define WORDS_FOR(bits) (((bits) + WORD_BITS - 1) / WORD_BITS)
+
 static size_t page_size;
 
+static inline size_t mask_words(const fixed_alloc *fa) {
+    return WORDS_FOR(fa->slots);
+}
+
+static inline size_t full_words(const fixed_alloc *fa) {
+    return WORDS_FOR(mask_words(fa));
+}
+
+static inline size_t reserve_pages(void) {
+    return FIXED_ALLOC_RESERVE_SIZE / page_size;
+}
+
 int fa_init(fixed_alloc *fa, size_t ty_size) {
     page_size = sysconf(_SC_PAGESIZE);
 
@@ -10,72 +27,194 @@ int fa_init(fixed_alloc *fa, size_t ty_size) {
     if (store == MAP_FAILED)
         return -1;
 
-    void *mask = mmap(NULL, FIXED_ALLOC_RESERVE_SIZE >> 3, PROT_READ | PROT_WRITE,
-                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    size_t slots = FIXED_ALLOC_RESERVE_SIZE / ty_size;
+    size_t mask_bytes = WORDS_FOR(slots) * sizeof(uint64_t);
+    size_t full_bytes = WORDS_FOR(WORDS_FOR(slots)) * sizeof(uint64_t);
 
+    // both bitmaps are only touched as the store grows, so the kernel
+    // commits them lazily
+    void *mask = mmap(NULL, mask_bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
     if (mask == MAP_FAILED)
         return -1;
 
+    void *full = mmap(NULL, full_bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (full == MAP_FAILED)
+        return -1;
+
+    void *live = mmap(NULL, reserve_pages() * sizeof(uint32_t), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (live == MAP_FAILED)
+        return -1;
+
+    void *released = mmap(NULL, WORDS_FOR(reserve_pages()) * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (released == MAP_FAILED)
+        return -1;
+
     *fa = (fixed_alloc){
         .store = store,
         .mask = mask,
+        .full = full,
         .next_page = store,
 
         .ty_size = ty_size,
+        .slots = slots,
+
+        .live = live,
+        .released = released,
     };
 
     return 0;
 }
 
-void *fa_malloc(fixed_alloc *fa) {
-    char *mask = (char *)fa->mask;
-
+static bool commit_through(fixed_alloc *fa, size_t slot) {
     size_t capacity = page_size * fa->pages;
+    size_t required = (slot + 1) * fa->ty_size;
 
-    if (fa->size + fa->ty_size > capacity) {
-        size_t additional_bytes = fa->size + fa->ty_size - capacity;
-        size_t pages_to_commit = additional_bytes / page_size + 1;
-        size_t bytes_to_commit = pages_to_commit * page_size;
+    if (required <= capacity)
+        return true;
+
+    size_t additional_bytes = required - capacity;
+    size_t pages_to_commit = additional_bytes / page_size + 1;
+    size_t bytes_to_commit = pages_to_commit * page_size;
+
+    if (mprotect(fa->next_page, bytes_to_commit, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+
+    fa->pages += pages_to_commit;
+    fa->next_page += bytes_to_commit;
+
+    return true;
+}
+
+static inline bool is_released(const fixed_alloc *fa, size_t page) {
+    return fa->released[page / WORD_BITS] & ((uint64_t)1 << (page % WORD_BITS));
+}
+
+static void release_pages(fixed_alloc *fa, size_t first, size_t count) {
+    if (madvise(fa->store + first * page_size, count * page_size, MADV_DONTNEED) != 0)
+        return;
+
+    for (size_t page = first; page < first + count; ++page)
+        fa->released[page / WORD_BITS] |= (uint64_t)1 << (page % WORD_BITS);
+
+    fa->released_pages += count;
+    fa->reclaimed += count * page_size;
+}
+
+// releases the oldest half of the queued empty pages, keeping the most
+// recently emptied ones resident since they are the likeliest to be reused
+static void release_empty_pages(fixed_alloc *fa) {
+    size_t run_start = 0, run_length = 0;
+
+    for (size_t i = 0; i < FIXED_ALLOC_RETAIN_PAGES; ++i) {
+        size_t page = fa->empty[i];
+
+        if (fa->live[page] != 0 || is_released(fa, page))
+            continue;
 
-        if (mprotect(fa->next_page, bytes_to_commit, PROT_READ | PROT_WRITE) != 0) {
-            return NULL;
+        if (run_length > 0 && page == run_start + run_length) {
+            ++run_length;
+            continue;
         }
 
-        fa->pages += pages_to_commit;
-        fa->next_page += bytes_to_commit;
+        if (run_length > 0)
+            release_pages(fa, run_start, run_length);
 
-        capacity += bytes_to_commit;
+        run_start = page;
+        run_length = 1;
     }
 
-    for (size_t byte_offset = 0; byte_offset < (capacity >> 3); ++byte_offset) {
-        int bit_offset = __builtin_ffs(~mask[byte_offset]);
-        if (bit_offset == 0 || bit_offset > 8)
+    if (run_length > 0)
+        release_pages(fa, run_start, run_length);
+
+    fa->empty_count -= FIXED_ALLOC_RETAIN_PAGES;
+    for (size_t i = 0; i < fa->empty_count; ++i)
+        fa->empty[i] = fa->empty[FIXED_ALLOC_RETAIN_PAGES + i];
+}
+
+static inline void slot_pages(const fixed_alloc *fa, size_t slot, size_t *first, size_t *last) {
+    *first = slot * fa->ty_size / page_size;
+    *last = ((slot + 1) * fa->ty_size - 1) / page_size;
+}
+
+static void pages_acquire(fixed_alloc *fa, size_t slot) {
+    size_t first, last;
+    slot_pages(fa, slot, &first, &last);
+
+    for (size_t page = first; page <= last; ++page) {
+        if (fa->live[page]++ == 0 && is_released(fa, page)) {
+            fa->released[page / WORD_BITS] &= ~((uint64_t)1 << (page % WORD_BITS));
+            --fa->released_pages;
+        }
+    }
+}
+
+static void pages_release(fixed_alloc *fa, size_t slot) {
+    size_t first, last;
+    slot_pages(fa, slot, &first, &last);
+
+    for (size_t page = first; page <= last; ++page) {
+        if (--fa->live[page] != 0)
             continue;
 
-        bit_offset = (bit_offset - 1) & 7;
-        mask[byte_offset] |= 1 << bit_offset;
+        fa->empty[fa->empty_count++] = page;
 
-        size_t offset = ((byte_offset << 3) + (bit_offset & 7)) * fa->ty_size;
-        fa->size += fa->ty_size;
-        return fa->store + offset;
+        if (fa->empty_count == 2 * FIXED_ALLOC_RETAIN_PAGES)
+            release_empty_pages(fa);
     }
+}
+
+void *fa_malloc(fixed_alloc *fa) {
+    size_t words = full_words(fa);
+
+    size_t full_idx = fa->hint;
+    while (full_idx < words && fa->full[full_idx] == WORD_FULL)
+        ++full_idx;
+
+    fa->hint = full_idx;
 
-    return NULL;
+    if (full_idx == words)
+        return NULL;
+
+    size_t mask_idx = full_idx * WORD_BITS + __builtin_ctzll(~fa->full[full_idx]);
+    size_t bit = __builtin_ctzll(~fa->mask[mask_idx]);
+    size_t slot = mask_idx * WORD_BITS + bit;
+
+    if (slot >= fa->slots || !commit_through(fa, slot))
+        return NULL;
+
+    fa->mask[mask_idx] |= (uint64_t)1 << bit;
+    if (fa->mask[mask_idx] == WORD_FULL)
+        fa->full[full_idx] |= (uint64_t)1 << (mask_idx % WORD_BITS);
+
+    pages_acquire(fa, slot);
+
+    fa->size += fa->ty_size;
+    return fa->store + slot * fa->ty_size;
 }
 
 void fa_free(fixed_alloc *fa, void *ptr) {
-    byte *mask = (byte *)fa->mask;
-
     size_t offset = (byte *)ptr - fa->store;
 
     assert(offset % fa->ty_size == 0);
 
-    offset /= fa->ty_size;
+    size_t slot = offset / fa->ty_size;
+    size_t mask_idx = slot / WORD_BITS;
+    size_t full_idx = mask_idx / WORD_BITS;
+
+    assert(fa->mask[mask_idx] & ((uint64_t)1 << (slot % WORD_BITS)));
+
+    fa->mask[mask_idx] &= ~((uint64_t)1 << (slot % WORD_BITS));
+    fa->full[full_idx] &= ~((uint64_t)1 << (mask_idx % WORD_BITS));
 
-    size_t byte_offset = offset >> 3;
-    size_t bit_offset = offset & 7;
+    if (full_idx < fa->hint)
+        fa->hint = full_idx;
 
-    mask[byte_offset] &= ~(1 << bit_offset);
+    pages_release(fa, slot);
 
     fa->size -= fa->ty_size;
 }
@@ -84,20 +223,27 @@ int fa_destroy(fixed_alloc *fa) {
     if (munmap(fa->store, FIXED_ALLOC_RESERVE_SIZE))
         return -1;
 
-    if (munmap(fa->mask, FIXED_ALLOC_RESERVE_SIZE >> 3))
+    if (munmap(fa->mask, mask_words(fa) * sizeof(uint64_t)))
+        return -1;
+
+    if (munmap(fa->full, full_words(fa) * sizeof(uint64_t)))
+        return -1;
+
+    if (munmap(fa->live, reserve_pages() * sizeof(uint32_t)))
+        return -1;
+
+    if (munmap(fa->released, WORDS_FOR(reserve_pages()) * sizeof(uint64_t)))
         return -1;
 
     return 0;
 }
 
 bool fa_valid_ptr(fixed_alloc *fa, void *ptr) {
-    byte *mask = (byte *)fa->mask;
-
     size_t offset = (byte *)ptr - fa->store;
 
     size_t capacity = fa->pages * page_size;
 
-    if (offset > capacity) {
+    if (offset >= capacity) {
         return false;
     }
 
@@ -105,10 +251,7 @@ bool fa_valid_ptr(fixed_alloc *fa, void *ptr) {
         return false;
     }
 
-    offset /= fa->ty_size;
-
-    size_t byte_offset = offset >> 3;
-    size_t bit_offset = offset & 7;
+    size_t slot = offset / fa->ty_size;
 
-    return mask[byte_offset] & (1 << bit_offset);
+    return fa->mask[slot / WORD_BITS] & ((uint64_t)1 << (slot % WORD_BITS));
 }
@@ -2,26 +2,54 @@
 #define FIXED_ALLOC_H
 
 #include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <unistd.h>
-#include <stdbool.h>
 
 // must be multiple of page size
 #ifndef FIXED_ALLOC_RESERVE_SIZE
 #define FIXED_ALLOC_RESERVE_SIZE 5llu * 1024llu * 1024llu * 1024llu  // 5 gigabytes
 #endif
 
+// empty pages kept resident before they are handed back to the os, once
+// twice this many have piled up the oldest ones are released
+#ifndef FIXED_ALLOC_RETAIN_PAGES
+#define FIXED_ALLOC_RETAIN_PAGES 64
+#endif
+
 typedef unsigned char byte;
 
+// Occupancy is tracked with a two level bitmap: one bit per slot in `mask`,
+// and one bit per mask word in `full`, set once every slot of that word is
+// taken. `hint` is the lowest `full` word that may still have a free slot,
+// so finding the lowest free slot is a couple of ctz instructions.
+//
+// `live` counts the slots overlapping each committed page. Pages that drop
+// to zero are queued in `empty` and released with madvise(MADV_DONTNEED)
+// once more than FIXED_ALLOC_RETAIN_PAGES are waiting; they stay mapped
+// and fault back in zeroed when a slot on them is reused.
 typedef struct {
     byte *store;
-    byte *mask;
+    uint64_t *mask;
+    uint64_t *full;
     byte *next_page;
 
     size_t size;
     size_t ty_size;
     size_t pages;
+
+    size_t slots;
+    size_t hint;
+
+    uint32_t *live;
+    uint64_t *released;
+    size_t empty[2 * FIXED_ALLOC_RETAIN_PAGES];
+    size_t empty_count;
+
+    size_t released_pages;
+    size_t reclaimed;  // bytes returned to the os over the allocator's lifetime
 } fixed_alloc;
 
 int fa_init(fixed_alloc *fa, size_t ty_size);
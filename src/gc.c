@@ -0,0 +1,255 @@
+#include "gc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+size_t gc_allocated;
+size_t gc_threshold = GC_THRESHOLD;
+
+typedef struct {
+    object **items;
+    size_t size;
+    size_t capacity;
+} obj_stack;
+
+static obj_stack roots;
+static obj_stack work;
+static obj_stack pending;
+static obj_stack garbage;
+
+static size_t collections;
+static size_t collected;
+
+static size_t traced;  // objects reached from the roots by this collection
+
+static void push(obj_stack *s, object *o) {
+    if (s->size == s->capacity) {
+        s->capacity = s->capacity ? 2 * s->capacity : 256;
+        s->items = (object **)realloc(s->items, s->capacity * sizeof(object *));
+
+        if (s->items == NULL) {
+            fprintf(stderr, "Error malloc collector");
+            exit(1);
+        }
+    }
+
+    s->items[s->size++] = o;
+}
+
+static inline object *pop(obj_stack *s) {
+    return s->items[--s->size];
+}
+
+static inline void visit_slot(object_slot *slot, void (*visit)(object *)) {
+    object *o = (object *)slot;
+    if (o->type == OBJECT_TYPE_LVALUE)
+        visit(o->ref);
+}
+
+// calls visit with every heap object o holds a count of, the same ones
+// release_obj drops
+static void visit_refs(object *o, void (*visit)(object *)) {
+    switch (o->type) {
+        case OBJECT_TYPE_LIST: {
+            if (o->values.store != NULL)
+                visit(o->values.store);
+        } break;
+        case OBJECT_TYPE_LIST_STORE: {
+            for (size_t i = o->lo; i < o->hi; ++i)
+                visit_slot(o->items + i, visit);
+        } break;
+        case OBJECT_TYPE_ENVIRONMENT: {
+            env_visit_refs(&o->env, visit);
+        } break;
+        case OBJECT_TYPE_CELL: {
+            if (o->cell.is_bound)
+                visit_slot(&o->cell.value, visit);
+        } break;
+        case OBJECT_TYPE_FUNCTION: {
+            switch (o->kind) {
+                case FUNCTION_KIND_NORMAL: {
+                    if (o->outer_env->obj != NULL)
+                        visit(o->outer_env->obj);
+                } break;
+                case FUNCTION_KIND_BOUND:
+                case FUNCTION_KIND_COMPOSED: {
+                    visit_slot(&o->callee, visit);
+                    visit_slot(&o->inner, visit);
+                } break;
+                default: {
+                }
+            }
+        } break;
+        default: {
+        }
+    }
+}
+
+void gc_buffer_root(object *o) {
+    o->color = GC_PURPLE;
+    o->buffered = true;
+    push(&roots, o);
+}
+
+static void mark_gray_ref(object *o) {
+    --o->rc;
+
+    if (o->color != GC_GRAY) {
+        o->color = GC_GRAY;
+        push(&work, o);
+        ++traced;
+    }
+}
+
+// subtracts the references among everything reachable from root
+static void mark_gray(object *root) {
+    if (root->color == GC_GRAY)
+        return;
+
+    root->color = GC_GRAY;
+    push(&work, root);
+    ++traced;
+
+    while (work.size > 0)
+        visit_refs(pop(&work), mark_gray_ref);
+}
+
+static void scan_black_ref(object *o) {
+    ++o->rc;
+
+    if (o->color != GC_BLACK) {
+        o->color = GC_BLACK;
+        push(&work, o);
+    }
+}
+
+// o is referenced from outside the traced objects, so is everything it
+// reaches: their references are added back
+static void scan_black(object *o) {
+    o->color = GC_BLACK;
+    push(&work, o);
+
+    while (work.size > 0)
+        visit_refs(pop(&work), scan_black_ref);
+}
+
+static void scan_ref(object *o) {
+    if (o->color == GC_GRAY)
+        push(&pending, o);
+}
+
+static void scan(object *root) {
+    push(&pending, root);
+
+    while (pending.size > 0) {
+        object *o = pop(&pending);
+        if (o->color != GC_GRAY)
+            continue;
+
+        if (o->rc > 0) {
+            scan_black(o);
+            continue;
+        }
+
+        o->color = GC_WHITE;
+        visit_refs(o, scan_ref);
+    }
+}
+
+static void collect_white(object *o) {
+    if (o->color == GC_WHITE) {
+        o->color = GC_GARBAGE;
+        push(&garbage, o);
+    }
+}
+
+static void restore_ref(object *o) {
+    ++o->rc;
+}
+
+size_t gc_collect(void) {
+    gc_allocated = 0;
+
+    // what dead objects still hold would keep cycles alive
+    free_dead(0);
+
+    if (roots.size == 0)
+        return 0;
+
+    size_t candidates = 0;
+    for (size_t i = 0; i < roots.size; ++i) {
+        object *o = roots.items[i];
+
+        if (o->color == GC_PURPLE) {
+            mark_gray(o);
+            roots.items[candidates++] = o;
+            continue;
+        }
+
+        // released while buffered, gray ones were reached from another root
+        if (o->color == GC_BLACK && o->rc == 0) {
+            free_obj(o);
+            continue;
+        }
+
+        o->buffered = false;
+    }
+    roots.size = candidates;
+
+    for (size_t i = 0; i < roots.size; ++i)
+        scan(roots.items[i]);
+
+    for (size_t i = 0; i < roots.size; ++i) {
+        roots.items[i]->buffered = false;
+        collect_white(roots.items[i]);
+    }
+    roots.size = 0;
+
+    // the garbage is appended to while it is walked
+    for (size_t i = 0; i < garbage.size; ++i)
+        visit_refs(garbage.items[i], collect_white);
+
+    // the references the garbage holds are counted again and each of it is
+    // held once more, so releasing it only frees what else it kept alive
+    for (size_t i = 0; i < garbage.size; ++i) {
+        visit_refs(garbage.items[i], restore_ref);
+        ++garbage.items[i]->rc;
+    }
+
+    for (size_t i = 0; i < garbage.size; ++i)
+        release_obj(garbage.items[i]);
+
+    for (size_t i = 0; i < garbage.size; ++i) {
+        assert(garbage.items[i]->rc == 1);
+        free_obj(garbage.items[i]);
+    }
+
+    size_t freed = garbage.size;
+    garbage.size = 0;
+
+    gc_threshold = GC_THRESHOLD + GC_GROWTH * (traced - freed);
+    traced = 0;
+
+    ++collections;
+    collected += freed;
+
+    return freed;
+}
+
+void gc_destroy(void) {
+    free(roots.items);
+    free(work.items);
+    free(pending.items);
+    free(garbage.items);
+
+    roots = work = pending = garbage = (obj_stack){0};
+    gc_allocated = 0;
+    gc_threshold = GC_THRESHOLD;
+}
+
+void print_gc_info(void) {
+    printf("\nCYCLE COLLECTOR\nCOLLECTIONS: %zu\nCOLLECTED: %zu\nROOTS: %zu\n",
+           collections, collected, roots.size);
+}
@@ -0,0 +1,77 @@
+#ifndef GC_H
+#define GC_H
+
+#include <stddef.h>
+
+#include "arena.h"
+#include "object.h"
+
+extern arena a;
+
+// Reference counting frees everything but cycles, like a recursive closure
+// and the frame it was made in. An environment, function, list or cell
+// whose count drops without reaching zero may be what is left of one, it is
+// buffered as a possible root. A collection subtracts the references the
+// objects reachable from the roots hold among themselves (trial deletion,
+// Bacon and Rajan): those left at zero are only referenced by each other.
+
+// least heap objects allocated between collections, a collection that
+// found objects alive waits for GC_GROWTH more allocations for each of
+// them before the next one traces them again
+#ifndef GC_THRESHOLD
+#define GC_THRESHOLD 16384
+#endif
+
+#ifndef GC_GROWTH
+#define GC_GROWTH 4
+#endif
+
+typedef enum {
+    GC_BLACK,    // in use
+    GC_PURPLE,   // possible root
+    GC_GRAY,     // references from the traced objects subtracted
+    GC_WHITE,    // only referenced by traced objects
+    GC_GARBAGE,  // being freed by the collector
+} gc_color;
+
+// allocations since the last collection, and how many start the next
+extern size_t gc_allocated;
+extern size_t gc_threshold;
+
+void gc_buffer_root(object *o);
+
+// frees the cycles among the objects reachable from the possible roots,
+// returns how many objects were freed
+size_t gc_collect(void);
+
+// forgets the possible roots, whose objects are freed with the arena
+void gc_destroy(void);
+
+void print_gc_info(void);
+
+// called by rc_dec on counts it leaves above zero
+static inline void gc_possible_root(object *o) {
+    if (o->buffered || o->color == GC_GARBAGE)
+        return;
+
+    switch (o->type) {
+        case OBJECT_TYPE_ENVIRONMENT:
+        case OBJECT_TYPE_FUNCTION:
+        case OBJECT_TYPE_LIST:
+        case OBJECT_TYPE_CELL: {
+            gc_buffer_root(o);
+        } break;
+        default: {
+        }
+    }
+}
+
+// collects once enough was allocated, only called where no uncounted
+// reference is held to anything but what the running frames keep alive.
+// Lazy freeing puts it off until the dead objects are freed
+static inline void gc_safepoint(void) {
+    if (gc_allocated >= gc_threshold && a.dead_count == 0)
+        (void)gc_collect();
+}
+
+#endif  // GC_H
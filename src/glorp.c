@@ -17,6 +17,11 @@ arena a;
 
 const char *program_name;
 
+static const char *engines[] = {
+    [GLORP_ENGINE_TREE] = "tree",
+    [GLORP_ENGINE_VM] = "vm",
+};
+
 int main(int argc, char *argv[]) {
     program_name = argv[0];
     argp_init(argc, argv, "An interpreted scripting language!", /* default_help */ true);
@@ -25,6 +30,14 @@ int main(int argc, char *argv[]) {
     bool *ast = argp_flag_bool("a", "ast", "print ast then exit");
     bool *repl = argp_flag_bool("r", "repl", "start interactive repl");
     bool *verbose = argp_flag_bool("V", "verbose", "verbose mode");
+    uint64_t *optimize = argp_flag_uint("O", NULL, "level", 0,
+                                        "0 runs the program as written, 1 folds constants and prunes dead branches");
+    bool *lazy_free = argp_flag_bool(NULL, "lazy-free",
+                                     "free dead objects a few at a time as new ones are allocated");
+    size_t *engine = argp_flag_enum(NULL, "engine", engines, GLORP_ENGINE_COUNT, GLORP_ENGINE_TREE,
+                                    "execution engine");
+    uint64_t *stack_size = argp_flag_uint(NULL, "stack-size", "MB", 256,
+                                          "size of the evaluation stacks");
 
     char **file = argp_pos_str("file", "", ARGP_OPT_OPTIONAL, "File to interpret, use '-' for stdin or repl when '-r' is specified to supply arguments");
     Argp_List *args = argp_pos_list("args", ARGP_OPT_OPTIONAL, "Arguments for program");
@@ -41,6 +54,10 @@ int main(int argc, char *argv[]) {
         .ast = *ast,
         .repl = *repl,
         .verbose = *verbose,
+        .optimize = *optimize > 0,
+        .lazy_free = *lazy_free,
+        .engine = (glorp_engine)*engine,
+        .stack_size = (size_t)*stack_size << 20,
     };
 
     options.repl |= options.file[0] == 0;
@@ -6,14 +6,26 @@
 
 #include "argparse.h"
 
+typedef enum {
+    GLORP_ENGINE_TREE,
+    GLORP_ENGINE_VM,
+
+    GLORP_ENGINE_COUNT,
+} glorp_engine;
+
 typedef struct {
     const char *file;
     Argp_List *args;
 
+    glorp_engine engine;
+    size_t stack_size;  // bytes for each of the evaluation stacks
+
     bool lex : 1;
     bool ast : 1;
     bool repl : 1;
     bool verbose : 1;
+    bool optimize : 1;
+    bool lazy_free : 1;  // spread freeing over allocations, see arena.h
 } glorp_options;
 
 #endif  // OPTIONS_H
@@ -4,214 +4,103 @@
 #include <stdio.h>
 #include <string.h>
 
-#define MAX_LOAD_FACTOR 0.7
-
-static bool find_avail(hash_table *ht, const char *key, size_t key_length,
-                 size_t scope, size_t *idx);
-static bool find(hash_table *ht, const char *key, size_t key_length,
-                 size_t scope, size_t *idx);
-static void ensure_load_factor(hash_table *ht);
-static void resize(hash_table *ht);
-inline static bool is_avail_item(const table_item *item);
-inline static bool is_null_item(const table_item *item);
-static size_t djb2_hash(const char *key, size_t key_length);
-static size_t hash_combine(size_t h1, size_t h2);
-
-static const size_t primes[] = {
-    53, 97, 193, 389, 769, 1543, 3079, 6151,
-    12289, 24593, 49157, 98317, 196613, 393241,
-    786433, 1572869, 3145739, 6291469, 12582917,
-    25165843, 50331653, 100663319, 201326611,
-    402653189, 805306457, 1610612741};
-
-static size_t cur_prime = 0;
-
-static size_t next_prime(void) {
-    return primes[cur_prime++];
-}
-
-void ht_init(hash_table *ht) {
-    size_t capacity = next_prime();
-    table_item *values =
-        (table_item *)calloc(capacity, sizeof(table_item));
+#include "object.h"
 
-    if (values == NULL) {
-        fprintf(stderr, "Error malloc hash_table");
-        exit(1);
-    }
+typedef struct {
+    const symbol *key;
+    size_t scope;
+} item_key;
 
-    *ht = (hash_table){
-        .size = 0,
-        .capacity = capacity,
-        .values = values,
-    };
+static inline uint64_t item_hash(const symbol *key, size_t scope) {
+    return key->hash ^ (scope * 11400714819323198485llu);
 }
 
-bool ht_set(hash_table *ht, const table_item *pair) {
-    size_t idx;
-    bool replace_existing = find_avail(ht, pair->key, pair->key_length, pair->scope, &idx);
-
-    if (!replace_existing) {
-        ht->values[idx] = *pair;
-        ++ht->size;
-    } else {
-        if (ht->values[idx].is_const) {
-            return false;
-        }
-        if (pair->is_const) {
-            return false;
-        }
-        ht->values[idx].value = pair->value;
-    }
-
-    ensure_load_factor(ht);
-    return true;
+static uint64_t table_item_hash(const void *item) {
+    const table_item *ti = (const table_item *)item;
+    return item_hash(ti->key, ti->scope);
 }
 
-bool ht_get(hash_table *ht, const char *key, size_t key_length, size_t scope,
-            object **ref, bool *is_const) {
-    size_t idx;
-    if (!find(ht, key, key_length, scope, &idx)) return false;
-
-    if (ref != NULL) {
-        *ref = ht->values[idx].value;
-    }
-    if (is_const != NULL) {
-        *is_const = ht->values[idx].is_const;
-    }
-    return true;
+static bool table_item_eq(const void *item, const void *key) {
+    const table_item *ti = (const table_item *)item;
+    const item_key *k = (const item_key *)key;
+    return ti->key == k->key && ti->scope == k->scope;
 }
 
-bool ht_remove(hash_table *ht, const char *key, size_t key_length,
-               size_t scope) {
-    size_t idx;
-    if (!find(ht, key, key_length, scope, &idx)) return false;
-
-    hti_set_avail(ht->values + idx);
-    --ht->size;
-    return true;
+static table_item *find(hash_table *ht, const symbol *key, size_t scope) {
+    item_key k = {
+        .key = key,
+        .scope = scope,
+    };
+    return (table_item *)st_find(&ht->items, item_hash(key, scope), &k, table_item_eq);
 }
 
-void ht_destroy(hash_table *ht) { free(ht->values); }
-
-void hti_set_avail(table_item *ht) {
-    ht->key[0] = 1;
+void ht_init(hash_table *ht) {
+    st_init(&ht->items, sizeof(table_item));
 }
 
-static bool find(hash_table *ht, const char *key, size_t key_length,
-                 size_t scope, size_t *idx) {
-    size_t h1 = djb2_hash(key, key_length);
-    size_t h2 = scope * 11400714819323198485llu;
-    size_t hash = hash_combine(h1, h2);
-
-    table_item *cur;
-    for (size_t i = 0;; ++i) {
-        *idx = (hash + i * i) % ht->capacity;
-        cur = ht->values + *idx;
-
-        if (is_null_item(cur)) {
-            return false;
-        }
-
-        if (strncmp(ht->values[*idx].key, key, key_length) == 0 &&
-            ht->values[*idx].scope == scope) {
-            break;
-        }
-    }
-    return true;
-}
+bool ht_set(hash_table *ht, const table_item *pair) {
+    table_item *item = find(ht, pair->key, pair->scope);
 
-static bool find_avail(hash_table *ht, const char *key, size_t key_length,
-                       size_t scope, size_t *idx) {
-    size_t h1 = djb2_hash(key, key_length);
-    size_t h2 = scope * 11400714819323198485llu;
-    size_t hash = hash_combine(h1, h2);
-
-    table_item *cur;
-    for (size_t i = 0;; ++i) {
-        *idx = (hash + i * i) % ht->capacity;
-        cur = ht->values + *idx;
-
-        if (is_null_item(cur) || is_avail_item(cur)) {
-            return false;
-        }
-
-        if (strncmp(ht->values[*idx].key, key, key_length) == 0 &&
-            ht->values[*idx].scope == scope) {
-            break;
-        }
+    if (item == NULL) {
+        item = (table_item *)st_insert(&ht->items, item_hash(pair->key, pair->scope),
+                                       table_item_hash);
+        *item = *pair;
+        return true;
     }
-    return true;
-}
-
-static void ensure_load_factor(hash_table *ht) {
-    float size = (float)ht->size;
-    float capacity = (float)ht->capacity;
-
-    float load_factor = size / capacity;
 
-    if (load_factor > MAX_LOAD_FACTOR) {
-        resize(ht);
+    if (item->is_const) {
+        return false;
     }
-}
-
-static void resize(hash_table *ht) {
-    table_item *temp = ht->values;
-    size_t old_capacity = ht->capacity;
-    size_t new_capacity = next_prime();
-
-    ht->values = (table_item *)calloc(new_capacity, sizeof(table_item));
-    ht->capacity = new_capacity;
-    ht->size = 0;
-
-    table_item *cur;
-    for (size_t i = 0; i < old_capacity; ++i) {
-        cur = temp + i;
-        if (is_null_item(cur)) {
-            continue;
-        }
-        ht_set(ht, &temp[i]);
+    if (pair->is_const) {
+        return false;
     }
+    slot_release(&item->value);
+    item->value = pair->value;
 
-    free(temp);
+    return true;
 }
 
-inline static bool is_avail_item(const table_item *item) {
-    return *item->key == 1;
-}
+bool ht_get(hash_table *ht, const symbol *key, size_t scope, object **ref, bool *is_const) {
+    table_item *item = find(ht, key, scope);
+    if (item == NULL) return false;
 
-inline static bool is_null_item(const table_item *item) {
-    return *item->key == 0;
+    if (ref != NULL) {
+        *ref = slot_obj(&item->value);
+    }
+    if (is_const != NULL) {
+        *is_const = item->is_const;
+    }
+    return true;
 }
 
-#define DJB2_PRIME 5381
+bool ht_remove(hash_table *ht, const symbol *key, size_t scope) {
+    table_item *item = find(ht, key, scope);
+    if (item == NULL) return false;
 
-static size_t djb2_hash(const char *key, size_t key_length) {
-    size_t hash = DJB2_PRIME;
-    for (size_t i = 0; i < key_length; ++i) {
-        hash = ((hash << 5) + hash) ^ ((size_t)key[i]);
-    }
-    return hash;
+    slot_release(&item->value);
+    st_erase(&ht->items, item);
+    return true;
 }
 
-static size_t hash_combine(size_t h1, size_t h2) {
-    return h1 ^ (h2 + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
-}
+void ht_destroy(hash_table *ht) { st_destroy(&ht->items); }
 
 void print_ht_info(const hash_table *ht) {
+    const swiss_table *st = &ht->items;
+
     printf("\n------\n");
 
-    printf("HASH TABLE\nSIZE: %zu\nCAPACITY: %lu\n", ht->size, ht->capacity);
+    printf("HASH TABLE\nSIZE: %zu\nCAPACITY: %zu\nPROBES PER LOOKUP: %.2f\n", st->size,
+           st->capacity, st->lookups ? (double)st->probes / (double)st->lookups : 0.0);
 
-    if (ht->size > 0)
+    if (st->size > 0)
         printf("\nVALUES:\n");
 
-    for (size_t i = 0; i < ht->capacity; ++i) {
-        const table_item *item = ht->values + i;
-        if (item->value == NULL)
+    for (size_t i = 0; i < st->capacity; ++i) {
+        if (!st_is_full(st, i))
             continue;
+        table_item *item = (table_item *)st_item(st, i);
         printf("%3zu: value: %3p, const: %d, scope: %zu, key: %.*s\n", i,
-               (void *)item->value, item->is_const, item->scope, (int)item->key_length,
-               item->key);
+               (void *)slot_obj(&item->value), item->is_const, item->scope,
+               (int)item->key->length, item->key->literal);
     }
 }
@@ -4,9 +4,13 @@
 
 #include "arena.h"
 #include "environment.h"
+#include "evalstack.h"
 #include "evaluator.h"
 #include "lexer.h"
+#include "optimizer.h"
 #include "parser.h"
+#include "resolver.h"
+#include "vm.h"
 
 extern arena a;
 
@@ -15,6 +19,41 @@ extern parser_error parser_err;
 
 #define BUF_SIZE 1024
 
+typedef struct {
+    expr *program;
+    environment *env;
+    object *result;
+} program_run;
+
+static bool run_program_on_stack(void *arg) {
+    program_run *run = (program_run *)arg;
+    const glorp_options *options = run->env->selected_options;
+
+    if (options->engine == GLORP_ENGINE_TREE)
+        return eval(run->program, run->env, run->result);
+
+    chunk *code = compile_program(run->program);
+    if (options->verbose)
+        print_chunk(code, options->file);
+
+    vm_init(options->stack_size);
+    return vm_run(code, run->env, run->result);
+}
+
+bool run_program(expr *program, environment *env, object *result) {
+    program_run run = {
+        .program = program,
+        .env = env,
+        .result = result,
+    };
+
+    // imports run inside the program importing them
+    if (eval_stack_limit == NULL)
+        call_depth = 0;
+
+    return run_on_eval_stack(env->selected_options->stack_size, run_program_on_stack, &run);
+}
+
 void interpret(const char *input, const glorp_options *selected_options) {
     const char *filename = selected_options->file;
     const size_t n = strlen(input);
@@ -28,6 +67,7 @@ void interpret(const char *input, const glorp_options *selected_options) {
     }
 
     arena_init(&a);
+    a.free_budget = selected_options->lazy_free ? FREE_BUDGET : 0;
 
     parser p;
     parser_init(&p, &l);
@@ -39,6 +79,9 @@ void interpret(const char *input, const glorp_options *selected_options) {
         return;
     }
 
+    if (selected_options->optimize)
+        optimize_program(program);
+
     if (selected_options->ast) {
         print_ast(program);
         return;
@@ -48,14 +91,16 @@ void interpret(const char *input, const glorp_options *selected_options) {
     ht_init(&ht);
 
     environment env;
-    environment_init(&env, NULL, &ht, 0);
+    environment_init(&env, NULL, &ht, 0, NULL);
     env.selected_options = selected_options;
 
     add_cmdline_args(selected_options->args->items, selected_options->args->size, &env);
     add_builtins(&env);
 
+    resolve_program(program, &env);
+
     object obj;
-    if (eval(program, &env, &obj)) {
+    if (run_program(program, &env, &obj)) {
         temp_cleanup(&obj);
     } else {
         inspect_eval_error(filename, &eval_err);
@@ -63,11 +108,15 @@ void interpret(const char *input, const glorp_options *selected_options) {
 
     if (selected_options->verbose) {
         print_debug_info();
-        print_ht_info(&ht);
+        print_env_info(&env);
+        print_symbols_info();
     }
 
+    env_destroy(&env);
+    vm_destroy();
     arena_destroy(&a);
     ht_destroy(&ht);
+    symbols_destroy();
 }
 
 bool interpret_with_env(const char *input, const glorp_options *selected_options, 
@@ -86,8 +135,14 @@ bool interpret_with_env(const char *input, const glorp_options *selected_options
         inspect_parser_error(filename, &parser_err);
         return false;
     }
+
+    if (selected_options->optimize)
+        optimize_program(program);
+
+    resolve_program(program, env);
+
     object obj;
-    if (eval(program, env, &obj)) {
+    if (run_program(program, env, &obj)) {
         temp_cleanup(&obj);
     } else {
         inspect_eval_error(filename, &eval_err);
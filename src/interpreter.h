@@ -6,6 +6,10 @@
 
 void interpret(const char *input, const glorp_options *selected_options);
 
+// runs a resolved program with the engine selected in env
+WARN_UNUSED_RESULT
+bool run_program(expr *program, environment *env, object *result);
+
 // evaluate imported files
 bool interpret_with_env(const char *input, const glorp_options *selected_options, environment *env);
 
@@ -1,29 +1,587 @@
 #include "object.h"
 
+#include <assert.h>
 #include <ctype.h>
 #include <string.h>
 
 #include "arena.h"
 
-void ol_append(object_list *ol, object *obj) {
-    object *ln = new_obj(OBJECT_TYPE_LIST_NODE, 1);
-    ln->value = obj;
+static_assert(offsetof(object, int_value) + sizeof(int64_t) <= SLOT_SIZE,
+              "scalars must fit in a slot");
+static_assert(offsetof(object, float_value) + sizeof(double) <= SLOT_SIZE,
+              "scalars must fit in a slot");
+static_assert(offsetof(object, ref) + sizeof(object *) <= SLOT_SIZE,
+              "references must fit in a slot");
+
+bool is_inline_type(object_type type) {
+    switch (type) {
+        case OBJECT_TYPE_NULL:
+        case OBJECT_TYPE_UNIT:
+        case OBJECT_TYPE_CHAR:
+        case OBJECT_TYPE_INT:
+        case OBJECT_TYPE_FLOAT:
+            return true;
+        default:
+            return false;
+    }
+}
 
-    if (ol->size == 0) {
-        ol->head = ln;
+// the value held by a slot, either the slot itself or the heap object it
+// references
+object *slot_obj(object_slot *slot) {
+    object *o = (object *)slot;
+    return o->type == OBJECT_TYPE_LVALUE ? o->ref : o;
+}
+
+// stores the result of an evaluation: scalars are copied into the slot,
+// lvalues to heap objects are shared and other temporaries are moved to the
+// heap, keeping the references they own
+void slot_store(object_slot *slot, const object *value) {
+    const object *v = value->type == OBJECT_TYPE_LVALUE ? value->ref : value;
+
+    if (is_inline_type(v->type)) {
+        object *o = (object *)slot;
+        copy_obj(o, v);
+        o->rc = OBJECT_RC_UNCOUNTED;
+        return;
+    }
+
+    object *heap_obj;
+    if (value->type == OBJECT_TYPE_LVALUE) {
+        heap_obj = value->ref;
+        ++heap_obj->rc;
     } else {
-        ol->tail->next = ln;
+        heap_obj = new_copied_obj(value);
+        heap_obj->rc = 1;
+    }
+
+    slot_set_ref(slot, heap_obj);
+}
+
+// stores a reference to heap_obj, taking over one of its counts
+void slot_set_ref(object_slot *slot, object *heap_obj) {
+    object *o = (object *)slot;
+    o->rc = OBJECT_RC_UNCOUNTED;
+    o->type = OBJECT_TYPE_LVALUE;
+    o->ref = heap_obj;
+}
+
+void slot_copy(object_slot *dst, const object_slot *src) {
+    *dst = *src;
+    slot_retain(dst);
+}
+
+void slot_retain(object_slot *slot) {
+    object *o = (object *)slot;
+    if (o->type == OBJECT_TYPE_LVALUE)
+        ++o->ref->rc;
+}
+
+void slot_release(object_slot *slot) {
+    object *o = (object *)slot;
+    if (o->type == OBJECT_TYPE_LVALUE)
+        rc_dec(o->ref);
+}
+
+#define OL_MIN_CAPACITY 4
+
+static inline bool is_packed(const object *store) {
+    return store->type == OBJECT_TYPE_STRING_STORE;
+}
+
+static inline size_t item_size(const object *store) {
+    return is_packed(store) ? 1 : sizeof(object_slot);
+}
+
+static inline char *item_at(const object *store, size_t i) {
+    return store->bytes + i * item_size(store);
+}
+
+static inline bool is_char_slot(const object_slot *slot) {
+    return ((const object *)slot)->type == OBJECT_TYPE_CHAR;
+}
+
+// allocates the item buffer of a store, small strings use the one inline
+static void alloc_items(object *store, size_t capacity) {
+    if (is_packed(store) && capacity <= STRING_SMALL_CAPACITY) {
+        store->bytes = store->small;
+        store->capacity = STRING_SMALL_CAPACITY;
+        return;
+    }
+
+    if (capacity < OL_MIN_CAPACITY)
+        capacity = OL_MIN_CAPACITY;
+
+    store->bytes = (char *)malloc(capacity * item_size(store));
+    store->capacity = capacity;
+
+    if (store->bytes == NULL) {
+        fprintf(stderr, "Error malloc list store");
+        exit(1);
+    }
+}
+
+void free_items(object *store) {
+    if (store->bytes != store->small)
+        free(store->bytes);
+}
+
+// the one-character strings, shared by every view of them. Being immortal
+// they are never owned, so writes copy them first. The same goes for the
+// stores of constants (see ol_make_const)
+static object char_stores[256];
+
+static object *char_store(char c) {
+    object *store = char_stores + (unsigned char)c;
+
+    if (store->rc == 0) {
+        *store = (object){
+            .rc = OBJECT_RC_IMMORTAL,
+            .type = OBJECT_TYPE_STRING_STORE,
+            .hi = 1,
+            .capacity = 1,
+        };
+        store->small[0] = c;
+        store->bytes = store->small;
+    }
+
+    return store;
+}
+
+static object *new_store(object_type type, size_t capacity) {
+    object *store = new_obj(type, 1);
+    alloc_items(store, capacity);
+    return store;
+}
+
+// copies n items of src to dst starting at the given indices, packed chars
+// become char slots when dst holds slots
+static void copy_items(object *dst, size_t dst_idx, const object *src, size_t src_idx, size_t n) {
+    if (is_packed(dst)) {
+        assert(is_packed(src));
+        memcpy(dst->bytes + dst_idx, src->bytes + src_idx, n);
+        return;
+    }
+
+    if (is_packed(src)) {
+        object c = {.type = OBJECT_TYPE_CHAR};
+        for (size_t i = 0; i < n; ++i) {
+            c.char_value = src->bytes[src_idx + i];
+            slot_store(dst->items + dst_idx + i, &c);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        slot_copy(dst->items + dst_idx + i, src->items + src_idx + i);
+}
+
+void release_items(object *store, size_t from, size_t to) {
+    if (is_packed(store))
+        return;
+
+    for (size_t i = from; i < to; ++i)
+        slot_release(store->items + i);
+}
+
+static inline bool starts_store(const object_list *ol) {
+    return ol->store != NULL && ol->offset == ol->store->lo;
+}
+
+static inline bool ends_store(const object_list *ol) {
+    return ol->store != NULL && ol->offset + ol->size == ol->store->hi;
+}
+
+// whether items of src can be copied into the store of ol
+static inline bool can_hold(const object_list *ol, const object_list *src) {
+    return !is_packed(ol->store) || src->size == 0 || is_packed(src->store);
+}
+
+// drops the items of a store outside of its only view
+static void trim(object_list *ol) {
+    object *store = ol->store;
+    assert(store->rc == 1);
+
+    release_items(store, store->lo, ol->offset);
+    release_items(store, ol->offset + ol->size, store->hi);
+
+    store->lo = ol->offset;
+    store->hi = ol->offset + ol->size;
+}
+
+// moves the items of ol to a new store of the given type, leaving room for
+// capacity items
+static void unshare(object_list *ol, object_type type, size_t capacity) {
+    object *store = new_store(type, capacity);
+
+    if (ol->size > 0)
+        copy_items(store, 0, ol->store, ol->offset, ol->size);
+    store->hi = ol->size;
+
+    rc_dec(ol->store);
+    ol->store = store;
+    ol->offset = 0;
+}
+
+// makes ol the only view of its store, covering all of it
+static void own(object_list *ol) {
+    if (ol->store->rc == 1)
+        trim(ol);
+    else
+        unshare(ol, ol->store->type, ol->size);
+}
+
+// turns a packed string into a list of char slots
+static void unpack(object_list *ol, size_t capacity) {
+    if (ol->store != NULL && is_packed(ol->store))
+        unshare(ol, OBJECT_TYPE_LIST_STORE, capacity);
+}
+
+// room for n more items past hi, views keep their offsets
+static void grow_back(object *store, size_t n) {
+    size_t needed = store->hi + n;
+    if (needed <= store->capacity)
+        return;
+
+    size_t capacity = store->capacity * 2;
+    if (capacity < needed)
+        capacity = needed;
+
+    if (store->bytes == store->small) {
+        alloc_items(store, capacity);
+        memcpy(store->bytes, store->small, store->hi);
+        return;
+    }
+
+    store->bytes = (char *)realloc(store->bytes, capacity * item_size(store));
+    store->capacity = capacity;
+
+    if (store->bytes == NULL) {
+        fprintf(stderr, "Error realloc list store");
+        exit(1);
+    }
+}
+
+// room for n more items before lo. The items are moved, so this is only
+// done for the only view of a store
+static void grow_front(object_list *ol, size_t n) {
+    object *store = ol->store;
+    assert(store->rc == 1);
+
+    if (store->lo >= n)
+        return;
+
+    size_t used = store->hi - store->lo;
+    size_t capacity = store->capacity * 2;
+    if (capacity < 2 * (used + n))
+        capacity = 2 * (used + n);
+
+    size_t lo = n + (capacity - used - n) / 2;
+
+    char *old_items = store->bytes;
+    char *old_start = item_at(store, store->lo);
+
+    alloc_items(store, capacity);
+    memcpy(item_at(store, lo), old_start, used * item_size(store));
+    if (old_items != store->small)
+        free(old_items);
+
+    ol->offset = ol->offset - store->lo + lo;
+    store->lo = lo;
+    store->hi = lo + used;
+}
+
+// whether n items can be written right after ol. Other views of the store
+// end before hi, so they never see the claimed items
+static bool claim_back(object_list *ol, size_t n) {
+    if (ol->store == NULL || is_immortal(ol->store))
+        return false;
+
+    if (ol->store->rc == 1)
+        trim(ol);
+
+    if (!ends_store(ol))
+        return false;
+
+    grow_back(ol->store, n);
+    return true;
+}
+
+// whether n items can be written right before ol
+static bool claim_front(object_list *ol, size_t n) {
+    if (ol->store == NULL)
+        return false;
+
+    if (ol->store->rc == 1)
+        trim(ol);
+
+    if (!starts_store(ol) || is_immortal(ol->store))
+        return false;
+
+    if (ol->store->lo < n) {
+        if (ol->store->rc != 1)
+            return false;
+        grow_front(ol, n);
+    }
+
+    return true;
+}
+
+void ol_reserve(object_list *ol, size_t capacity) {
+    assert(capacity >= ol->size);
+
+    // a single item may turn out to be a char, which needs no store
+    if (ol->store == NULL && capacity <= 1)
+        return;
+
+    if (!claim_back(ol, capacity - ol->size))
+        unshare(ol, ol->store ? ol->store->type : OBJECT_TYPE_LIST_STORE, capacity);
+}
+
+// a packed string holding a copy of the given bytes
+void ol_init_str(object_list *ol, const char *str, size_t length) {
+    *ol = (object_list){0};
+
+    if (length == 0)
+        return;
+
+    if (length == 1) {
+        *ol = (object_list){
+            .store = char_store(str[0]),
+            .size = 1,
+        };
+        return;
+    }
+
+    ol->store = new_store(OBJECT_TYPE_STRING_STORE, length);
+    memcpy(ol->store->bytes, str, length);
+    ol->store->hi = length;
+    ol->size = length;
+}
+
+// a list of all the items of a constant store, NULL for an empty one
+void ol_init_const(object_list *ol, object *store) {
+    if (store == NULL) {
+        *ol = (object_list){0};
+        return;
+    }
+
+    *ol = (object_list){
+        .store = store,
+        .offset = store->lo,
+        .size = store->hi - store->lo,
+    };
+    ++store->rc;
+}
+
+// makes the store of ol a constant kept until the arena is destroyed and
+// returns it, ol is left one of its views
+object *ol_make_const(object_list *ol) {
+    if (ol->store == NULL || is_immortal(ol->store))
+        return ol->store;
+
+    own(ol);
+    make_constant(ol->store);
+    return ol->store;
+}
+
+// takes over the references held by slot
+void ol_append(object_list *ol, const object_slot *slot) {
+    if (ol->store == NULL) {
+        if (is_char_slot(slot)) {
+            *ol = (object_list){
+                .store = char_store(((const object *)slot)->char_value),
+                .size = 1,
+            };
+            return;
+        }
+
+        unshare(ol, OBJECT_TYPE_LIST_STORE, 1);
+    } else if (is_packed(ol->store) && !is_char_slot(slot)) {
+        unpack(ol, ol->size + 1);
+    }
+
+    ol_reserve(ol, ol->size + 1);
+
+    object *store = ol->store;
+    if (is_packed(store)) {
+        store->bytes[store->hi++] = ((const object *)slot)->char_value;
+    } else {
+        store->items[store->hi++] = *slot;
     }
-    ol->tail = ln;
     ++ol->size;
 }
 
+void ol_extend(object_list *ol, const object_list *src) {
+    if (src->size == 0)
+        return;
+
+    if (ol->store == NULL)
+        unshare(ol, src->store->type, src->size);
+    else if (!can_hold(ol, src))
+        unpack(ol, ol->size + src->size);
+
+    ol_reserve(ol, ol->size + src->size);
+
+    copy_items(ol->store, ol->store->hi, src->store, src->offset, src->size);
+    ol->store->hi += src->size;
+    ol->size += src->size;
+}
+
+static void prepend(object_list *ol, const object_list *src) {
+    object *store = ol->store;
+    store->lo -= src->size;
+    copy_items(store, store->lo, src->store, src->offset, src->size);
+    ol->offset -= src->size;
+    ol->size += src->size;
+}
+
+// concatenates two lists, taking over the references of both. When the
+// larger list's store has room next to it the smaller one is copied into
+// it, otherwise both go to a new store with room on either side. A list
+// built one item at a time from either end is copied O(log n) times
+void ol_concat(object_list *result, object_list *left, object_list *right) {
+    if (left->size == 0 || right->size == 0) {
+        object_list *empty = left->size == 0 ? left : right;
+        *result = left->size == 0 ? *right : *left;
+        rc_dec(empty->store);
+        return;
+    }
+
+    if (left->size <= right->size) {
+        if (can_hold(right, left) && claim_front(right, left->size)) {
+            prepend(right, left);
+            *result = *right;
+            rc_dec(left->store);
+            return;
+        }
+    } else if (can_hold(left, right) && claim_back(left, right->size)) {
+        ol_extend(left, right);
+        *result = *left;
+        rc_dec(right->store);
+        return;
+    }
+
+    // room on both sides for the next concatenation
+    object_type type = is_packed(left->store) && is_packed(right->store)
+                           ? OBJECT_TYPE_STRING_STORE
+                           : OBJECT_TYPE_LIST_STORE;
+    size_t size = left->size + right->size;
+    object *store = new_store(type, 2 * size);
+    store->lo = store->hi = (store->capacity - size) / 2;
+
+    *result = (object_list){
+        .store = store,
+        .offset = store->lo,
+    };
+    ol_extend(result, left);
+    ol_extend(result, right);
+
+    rc_dec(left->store);
+    rc_dec(right->store);
+}
+
+// makes dst a view of src without its first `from` items
+void ol_slice(object_list *dst, const object_list *src, size_t from) {
+    assert(from <= src->size);
+
+    if (from == src->size) {
+        *dst = (object_list){0};
+        return;
+    }
+
+    *dst = (object_list){
+        .store = src->store,
+        .offset = src->offset + from,
+        .size = src->size - from,
+    };
+    ++dst->store->rc;
+}
+
+void ol_remove(object_list *ol, size_t idx) {
+    assert(idx < ol->size);
+    own(ol);
+
+    object *store = ol->store;
+    size_t i = ol->offset + idx;
+
+    release_items(store, i, i + 1);
+    memmove(item_at(store, i), item_at(store, i + 1), (store->hi - i - 1) * item_size(store));
+
+    --store->hi;
+    --ol->size;
+
+    // empty lists hold no store, as in ol_slice
+    if (ol->size == 0) {
+        rc_dec(store);
+        ol->store = NULL;
+        ol->offset = 0;
+    }
+}
+
+// sets result to an lvalue referencing the item, or to a copy of it for
+// packed strings whose items are not objects
+void ol_ref(const object_list *ol, size_t idx, object *result) {
+    assert(idx < ol->size);
+
+    const object *store = ol->store;
+    size_t i = ol->offset + idx;
+
+    if (is_packed(store)) {
+        *result = (object){
+            .type = OBJECT_TYPE_CHAR,
+            .char_value = store->bytes[i],
+        };
+    } else {
+        *result = (object){
+            .type = OBJECT_TYPE_LVALUE,
+            .ref = slot_obj(store->items + i),
+        };
+    }
+}
+
+// the slot of an item for writing, unsharing the store first
+object_slot *ol_mut(object_list *ol, size_t idx) {
+    assert(idx < ol->size);
+    if (is_packed(ol->store))
+        unpack(ol, ol->size);
+    else
+        own(ol);
+    return ol->store->items + ol->offset + idx;
+}
+
+// replaces an item, taking over the references held by slot. Returns the
+// stored value, or NULL when it was packed into a string
+object *ol_set(object_list *ol, size_t idx, const object_slot *slot) {
+    assert(idx < ol->size);
+
+    if (is_packed(ol->store) && is_char_slot(slot)) {
+        own(ol);
+        ol->store->bytes[ol->offset + idx] = ((const object *)slot)->char_value;
+        return NULL;
+    }
+
+    object_slot *dst = ol_mut(ol, idx);
+    slot_release(dst);
+    *dst = *slot;
+    return slot_obj(dst);
+}
+
+// the bytes of a packed string
+const char *ol_str(const object_list *ol) {
+    if (ol->store == NULL || !is_packed(ol->store))
+        return NULL;
+    return ol->store->bytes + ol->offset;
+}
+
 ol_iterator ol_start(const object_list *ol) {
-    object *ln = ol->head;
-    object *obj = ln ? ln->value : NULL;
+    assert(ol->store == NULL || !is_packed(ol->store));
+    object_slot *slot = ol->store ? ol->store->items + ol->offset : NULL;
+    object_slot *end = slot + ol->size;
     return (ol_iterator){
-        .obj = obj,
-        .ln = ln,
+        .obj = slot != end ? slot_obj(slot) : NULL,
+        .slot = slot,
+        .end = end,
     };
 }
 
@@ -31,14 +589,12 @@ void oli_next(ol_iterator *oli) {
     if (oli_is_end(oli))
         return;
 
-    object *next_ln = oli->ln->next;
-
-    oli->ln = next_ln;
-    oli->obj = next_ln ? next_ln->value : NULL;
+    ++oli->slot;
+    oli->obj = oli->slot != oli->end ? slot_obj(oli->slot) : NULL;
 }
 
 bool oli_is_end(const ol_iterator *oli) {
-    return oli->ln == NULL;
+    return oli->slot == oli->end;
 }
 
 // inspecting (printing) objects
@@ -138,13 +694,28 @@ static void inspect_float(const object *obj, String_Builder *sb, bool from_print
     sb_appendf(sb, "%g", obj->float_value);
 }
 
+size_t fn_param_count(const object *fn) {
+    switch (fn->kind) {
+        case FUNCTION_KIND_BUILTIN:
+            return fn->builtin_param_count;
+        case FUNCTION_KIND_BOUND:
+            return fn_param_count(slot_obj((object_slot *)&fn->callee)) - 1;
+        case FUNCTION_KIND_COMPOSED:
+            return fn_param_count(slot_obj((object_slot *)&fn->inner));
+        default:
+            return fn->params.size;
+    }
+}
+
 static void inspect_function(const object *obj, String_Builder *sb, bool from_print) {
     (void)from_print;
-    size_t param_count = obj->builtin ? obj->builtin_param_count : obj->params.size;
-    sb_appendf(sb, "function(%zu)", param_count);
+    sb_appendf(sb, "function(%zu)", fn_param_count(obj));
 }
 
 static bool check_str(const object_list *values) {
+    if (ol_str(values) != NULL)
+        return true;
+
     ol_iterator it = ol_start(values);
 
     for (; !oli_is_end(&it); oli_next(&it)) {
@@ -160,10 +731,16 @@ static void inspect_str(const object_list *values, String_Builder *sb, bool from
     if (!from_print)
         sb_append_buf(sb, "\"", 1);
 
-    ol_iterator it = ol_start(values);
+    const char *str = ol_str(values);
 
-    for (; !oli_is_end(&it); oli_next(&it)) {
-        sb_appendf(sb, "%c", it.obj->char_value);
+    if (str != NULL) {
+        sb_append_buf(sb, str, values->size);
+    } else {
+        ol_iterator it = ol_start(values);
+
+        for (; !oli_is_end(&it); oli_next(&it)) {
+            sb_appendf(sb, "%c", it.obj->char_value);
+        }
     }
 
     if (!from_print)
@@ -7,12 +7,20 @@
 #include "ast.h"
 #include "environment.h"
 #include "sb.h"
+#include "slot.h"
 
 typedef struct object_list object_list;
 
+// strings up to this many bytes are kept inside their store object
+#define STRING_SMALL_CAPACITY 16
+
+// A list is a view of `size` items starting at `offset` in a store, which
+// may be shared with other lists (tails made by prepend unpacking). Stores
+// are copied on write once they are shared. Strings are packed into a
+// store of bytes until something other than a char is written to them.
 struct object_list {
-    object *head;
-    object *tail;
+    object *store;
+    size_t offset;
     size_t size;
 };
 
@@ -31,12 +39,21 @@ typedef enum {
     OBJECT_TYPE_LVALUE,
 
     // don't get evaluated
-    OBJECT_TYPE_LIST_NODE,
+    OBJECT_TYPE_LIST_STORE,
+    OBJECT_TYPE_STRING_STORE,
     OBJECT_TYPE_ENVIRONMENT,
+    OBJECT_TYPE_CELL,
 
     OBJECT_TYPE_ENUM_LENGTH,
 } object_type;
 
+typedef enum {
+    FUNCTION_KIND_NORMAL,
+    FUNCTION_KIND_BUILTIN,
+    FUNCTION_KIND_BOUND,     // callee with its first argument bound
+    FUNCTION_KIND_COMPOSED,  // callee applied to the result of inner
+} function_kind;
+
 typedef bool builtin_fn_t(const expr_list *params, const expr *call, environment *env, object *result);
 
 typedef struct object object;
@@ -45,6 +62,8 @@ struct object {
     size_t rc;
 
     object_type type;
+    uint8_t color;  // gc_color of heap objects, see gc.h
+    bool buffered;  // among the possible roots of the cycle collector
     union {
         // char
         char char_value;
@@ -57,12 +76,14 @@ struct object {
 
         // function
         struct {
-            bool builtin;
+            function_kind kind;
             union {
                 // normal functions
                 struct {
                     expr_list params;
                     const expr *body;
+                    frame_layout *layout;
+                    const chunk *code;  // NULL when the body is walked
                 };
 
                 // builtin functions
@@ -70,6 +91,15 @@ struct object {
                     size_t builtin_param_count;
                     builtin_fn_t *builtin_fn;
                 };
+
+                // bound and composed functions, neither has an outer_env
+                struct {
+                    object_slot callee;
+                    union {
+                        object_slot bound_arg;
+                        object_slot inner;
+                    };
+                };
             };
 
             environment *outer_env;
@@ -84,28 +114,77 @@ struct object {
             bool is_const;
         };
 
-        // list node
+        // list and string stores, items in [lo, hi) are in use
         struct {
-            object *value;
-            object *next;
+            union {
+                object_slot *items;  // list store
+                char *bytes;         // string store
+            };
+            size_t lo;
+            size_t hi;
+            size_t capacity;
+            char small[STRING_SMALL_CAPACITY];  // string store only
         };
 
         // environment
         environment env;
+
+        // cell, a variable shared by the frame binding it and the closures
+        // capturing it
+        env_binding cell;
     };
 };
 
+// rc of a scalar stored in a slot, which is never reference counted
+#define OBJECT_RC_UNCOUNTED SIZE_MAX
+
+// rc of an object shared for as long as the program runs, far enough from
+// zero that no count of references reaches it
+#define OBJECT_RC_IMMORTAL (SIZE_MAX / 2)
+
+static inline bool is_immortal(const object *o) {
+    return o->rc >= OBJECT_RC_IMMORTAL / 2;
+}
+
+bool is_inline_type(object_type type);
+
+object *slot_obj(object_slot *slot);
+void slot_store(object_slot *slot, const object *value);
+void slot_set_ref(object_slot *slot, object *heap_obj);
+void slot_copy(object_slot *dst, const object_slot *src);
+void slot_retain(object_slot *slot);
+void slot_release(object_slot *slot);
+
 typedef struct {
     object *obj;
-    object *ln;
+    object_slot *slot;
+    object_slot *end;
 } ol_iterator;
 
-void ol_append(object_list *ol, object *obj);
+void free_items(object *store);
+void release_items(object *store, size_t from, size_t to);
+
+void ol_reserve(object_list *ol, size_t capacity);
+void ol_init_str(object_list *ol, const char *str, size_t length);
+void ol_init_const(object_list *ol, object *store);
+object *ol_make_const(object_list *ol);
+void ol_append(object_list *ol, const object_slot *slot);
+void ol_extend(object_list *ol, const object_list *src);
+void ol_concat(object_list *result, object_list *left, object_list *right);
+void ol_slice(object_list *dst, const object_list *src, size_t from);
+void ol_remove(object_list *ol, size_t idx);
+void ol_ref(const object_list *ol, size_t idx, object *result);
+object_slot *ol_mut(object_list *ol, size_t idx);
+object *ol_set(object_list *ol, size_t idx, const object_slot *slot);
+const char *ol_str(const object_list *ol);
 ol_iterator ol_start(const object_list *ol);
 
 void oli_next(ol_iterator *oli);
 bool oli_is_end(const ol_iterator *oli);
 
+// arguments a call to the function fn takes
+size_t fn_param_count(const object *fn);
+
 void inspect(const object *obj, String_Builder *sb, bool from_print);
 
 #endif  // OBJECT_H
@@ -0,0 +1,247 @@
+#include "optimizer.h"
+
+#include <stdint.h>
+
+#include "evaluator.h"
+
+static void optimize(expr *e);
+
+static void optimize_list(const expr_list *list) {
+    for (expr *e = list->head; e != NULL; e = e->next) {
+        optimize(e);
+    }
+}
+
+// the value of a literal that needs no evaluation
+static bool literal_value(const expr *e, object *o) {
+    switch (e->type) {
+        case EXPR_TYPE_UNIT: {
+            *o = (object){.type = OBJECT_TYPE_UNIT};
+        } break;
+        case EXPR_TYPE_CHAR_LITERAL: {
+            *o = (object){.type = OBJECT_TYPE_CHAR, .char_value = e->char_value};
+        } break;
+        case EXPR_TYPE_INT_LITERAL: {
+            *o = (object){.type = OBJECT_TYPE_INT, .int_value = e->int_value};
+        } break;
+        case EXPR_TYPE_FLOAT_LITERAL: {
+            *o = (object){.type = OBJECT_TYPE_FLOAT, .float_value = e->float_value};
+        } break;
+        default: {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool number_value(const expr *e, object *o) {
+    return (e->type == EXPR_TYPE_INT_LITERAL || e->type == EXPR_TYPE_FLOAT_LITERAL) &&
+           literal_value(e, o);
+}
+
+// turns e into the literal of value, keeping its tokens so errors still
+// point at the folded source
+static void set_literal(expr *e, const object *value) {
+    e->quick = QUICK_UNSEEN;
+
+    if (value->type == OBJECT_TYPE_INT) {
+        e->type = EXPR_TYPE_INT_LITERAL;
+        e->int_value = value->int_value;
+    } else {
+        e->type = EXPR_TYPE_FLOAT_LITERAL;
+        e->float_value = value->float_value;
+    }
+}
+
+// puts replacement, a subtree of e, in the place of e
+static void replace(expr *e, const expr *replacement) {
+    expr *next = e->next;
+    *e = *replacement;
+    e->next = next;
+}
+
+// whether evaluating the operator of infix_expr on left and right is
+// defined, otherwise the trap or undefined behaviour happens at run time
+static bool foldable(const expr *infix_expr, const object *left, const object *right) {
+    bool ints = left->type == OBJECT_TYPE_INT && right->type == OBJECT_TYPE_INT;
+
+    switch (infix_expr->op.type) {
+        case TOKEN_TYPE_PLUS:
+        case TOKEN_TYPE_MINUS:
+        case TOKEN_TYPE_ASTERISK:
+        case TOKEN_TYPE_LT:
+        case TOKEN_TYPE_GT:
+        case TOKEN_TYPE_LT_EQ:
+        case TOKEN_TYPE_GT_EQ:
+        case TOKEN_TYPE_EQ:
+        case TOKEN_TYPE_NOT_EQ:
+        case TOKEN_TYPE_LAND:
+        case TOKEN_TYPE_LOR:
+            return true;
+        case TOKEN_TYPE_SLASH:
+            return !ints || (right->int_value != 0 &&
+                             !(left->int_value == INT64_MIN && right->int_value == -1));
+        case TOKEN_TYPE_PERCENT:
+            return ints && right->int_value != 0;
+        case TOKEN_TYPE_BAND:
+        case TOKEN_TYPE_BOR:
+        case TOKEN_TYPE_XOR:
+            return ints;
+        case TOKEN_TYPE_LEFT_SHIFT:
+            return ints && left->int_value >= 0 && right->int_value >= 0 &&
+                   right->int_value < 64;
+        case TOKEN_TYPE_RIGHT_SHIFT:
+            return ints && right->int_value >= 0 && right->int_value < 64;
+        default:
+            return false;
+    }
+}
+
+static void optimize_infix(expr *infix_expr) {
+    switch (infix_expr->op.type) {
+        // patterns and parameters are left as written
+        case TOKEN_TYPE_ASSIGN:
+        case TOKEN_TYPE_COLON_COLON:
+        case TOKEN_TYPE_RIGHT_ARROW: {
+            optimize(infix_expr->right);
+        } return;
+        default: {
+            optimize(infix_expr->left);
+            optimize(infix_expr->right);
+        }
+    }
+
+    object left, right, value;
+    if (!number_value(infix_expr->left, &left) || !number_value(infix_expr->right, &right))
+        return;
+
+    if (!foldable(infix_expr, &left, &right))
+        return;
+
+    if (eval_infix_values(infix_expr, &left, &right, &value))
+        set_literal(infix_expr, &value);
+}
+
+static void optimize_prefix(expr *prefix_expr) {
+    optimize(prefix_expr->right);
+
+    switch (prefix_expr->op.type) {
+        case TOKEN_TYPE_MINUS:
+        case TOKEN_TYPE_BANG:
+        case TOKEN_TYPE_NOT: {
+        } break;
+        default: {
+        } return;
+    }
+
+    object value;
+    if (!number_value(prefix_expr->right, &value))
+        return;
+
+    if (eval_prefix_value(prefix_expr, &value, NULL))
+        set_literal(prefix_expr, &value);
+}
+
+static void optimize_ternary(expr *ternary_expr) {
+    optimize(ternary_expr->condition);
+    optimize(ternary_expr->consequence);
+    optimize(ternary_expr->alternative);
+
+    object condition;
+    if (!literal_value(ternary_expr->condition, &condition))
+        return;
+
+    if (is_truthy(&condition)) {
+        replace(ternary_expr, ternary_expr->consequence);
+    } else {
+        replace(ternary_expr, ternary_expr->alternative);
+    }
+}
+
+// drops guards that are never true and everything after one that always is
+static void optimize_case(expr *case_expr) {
+    optimize_list(&case_expr->conditions);
+    optimize_list(&case_expr->results);
+
+    expr_list conditions = {0};
+    expr_list results = {0};
+
+    expr *condition_expr = case_expr->conditions.head;
+    expr *result_expr = case_expr->results.head;
+
+    while (condition_expr != NULL) {
+        expr *next_condition = condition_expr->next;
+        expr *next_result = result_expr->next;
+
+        object condition;
+        bool is_literal = literal_value(condition_expr, &condition);
+
+        if (!is_literal || is_truthy(&condition)) {
+            condition_expr->next = NULL;
+            result_expr->next = NULL;
+            el_append(&conditions, condition_expr);
+            el_append(&results, result_expr);
+        }
+
+        if (is_literal && is_truthy(&condition))
+            break;
+
+        condition_expr = next_condition;
+        result_expr = next_result;
+    }
+
+    case_expr->conditions = conditions;
+    case_expr->results = results;
+
+    if (conditions.size == 0) {
+        expr *next = case_expr->next;
+        *case_expr = (expr){
+            .start_tok = case_expr->start_tok,
+            .end_tok = case_expr->end_tok,
+            .next = next,
+            .type = EXPR_TYPE_UNIT,
+        };
+        return;
+    }
+
+    // guards left that are literals always hold
+    object first;
+    if (literal_value(conditions.head, &first))
+        replace(case_expr, results.head);
+}
+
+static void optimize(expr *e) {
+    switch (e->type) {
+        case EXPR_TYPE_PROGRAM:
+        case EXPR_TYPE_LIST_LITERAL:
+        case EXPR_TYPE_BLOCK_EXPRESSION: {
+            optimize_list(&e->expressions);
+        } break;
+        case EXPR_TYPE_PREFIX_EXPRESSION: {
+            optimize_prefix(e);
+        } break;
+        case EXPR_TYPE_INFIX_EXPRESSION: {
+            optimize_infix(e);
+        } break;
+        case EXPR_TYPE_TERNARY_EXPRESSION: {
+            optimize_ternary(e);
+        } break;
+        case EXPR_TYPE_CALL_EXPRESSION: {
+            optimize(e->function);
+            optimize_list(&e->params);
+        } break;
+        case EXPR_TYPE_INDEX_EXPRESSION: {
+            optimize(e->list);
+            optimize(e->index);
+        } break;
+        case EXPR_TYPE_CASE_EXPRESSION: {
+            optimize_case(e);
+        } break;
+        default: {
+        }
+    }
+}
+
+void optimize_program(expr *program) {
+    optimize(program);
+}
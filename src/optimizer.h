@@ -0,0 +1,13 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "ast.h"
+
+// Runs between parsing and resolving. Arithmetic on number literals is
+// folded with the same semantics as evaluating it, except where that
+// would trap (e.g. integer division by zero), which is left for run time.
+// Ternaries and case guards with literal conditions keep only the branches
+// that can be taken.
+void optimize_program(expr *program);
+
+#endif  // OPTIMIZER_H
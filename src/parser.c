@@ -251,6 +251,7 @@ static expr *parse_identifier(parser *p) {
 
     identifier->literal = tok->literal;
     identifier->length = tok->length;
+    identifier->sym = intern(tok->literal, tok->length);
 
     return identifier;
 }
@@ -6,8 +6,12 @@
 #include "bumpalloc.h"
 #include "evaluator.h"
 #include "glorpoptions.h"
+#include "interpreter.h"
+#include "optimizer.h"
 #include "lexer.h"
 #include "parser.h"
+#include "resolver.h"
+#include "vm.h"
 #include "readline/history.h"
 #include "readline/readline.h"
 
@@ -40,6 +44,7 @@ void start_repl(glorp_options *options) {
     lexer l;
 
     arena_init(&a);
+    a.free_budget = options->lazy_free ? FREE_BUDGET : 0;
 
     parser p = {0};
 
@@ -49,7 +54,7 @@ void start_repl(glorp_options *options) {
     ht_init(&ht);
 
     environment env;
-    environment_init(&env, NULL, &ht, 0);
+    environment_init(&env, NULL, &ht, 0, NULL);
     env.selected_options = options;
 
     add_cmdline_args(options->args->items, options->args->size, &env);
@@ -129,6 +134,9 @@ void start_repl(glorp_options *options) {
         if (options->verbose)
             arena_print_exprs();
 
+        if (options->optimize)
+            optimize_program(program);
+
         if (options->ast) {
             print_ast(program);
             continue;
@@ -137,8 +145,10 @@ void start_repl(glorp_options *options) {
         if (program->expressions.size == 0)
             continue;
 
+        resolve_program(program, &env);
+
         object obj;
-        if (eval(program, &env, &obj)) {
+        if (run_program(program, &env, &obj)) {
             if (obj.type != OBJECT_TYPE_UNIT) {
                 inspect(&obj, &out, false);
                 printf("%.*s\n", (int)out.size, out.store);
@@ -151,13 +161,17 @@ void start_repl(glorp_options *options) {
 
         if (options->verbose) {
             print_debug_info();
-            print_ht_info(&ht);
+            print_env_info(&env);
+            print_symbols_info();
         }
     }
 
     clear_history();
     sb_free(&in);
     ba_destroy(&line_alloc);
+    env_destroy(&env);
+    vm_destroy();
     arena_destroy(&a);
     ht_destroy(&ht);
+    symbols_destroy();
 }
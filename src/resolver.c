@@ -0,0 +1,405 @@
+#include "resolver.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+
+extern arena a;
+
+typedef struct scope scope;
+
+struct scope {
+    scope *outer;
+
+    // NULL for a top level whose variables are looked up by name
+    frame_layout *layout;
+
+    // set on the top level of the global environment, which declares
+    // variables on first use
+    environment *globals;
+
+    // the functions nested in this one are flat
+    bool nests_flat;
+
+    // identifiers of a flat function resolved to the top level, which is
+    // one environment further out once the function captures anything
+    expr **top_idents;
+    size_t top_ident_count;
+    size_t top_ident_capacity;
+};
+
+typedef void visit_fn(scope *s, expr *e);
+
+static visit_fn collect;
+static visit_fn resolve;
+
+static inline bool is_function_literal(const expr *e) {
+    return e->type == EXPR_TYPE_INFIX_EXPRESSION && e->op.type == TOKEN_TYPE_RIGHT_ARROW;
+}
+
+static inline bool is_assignment(const expr *e) {
+    return e->type == EXPR_TYPE_INFIX_EXPRESSION &&
+           (e->op.type == TOKEN_TYPE_ASSIGN || e->op.type == TOKEN_TYPE_COLON_COLON);
+}
+
+static void grow(void **items, size_t *capacity, size_t item_size) {
+    *capacity = *capacity ? 2 * *capacity : 8;
+    *items = realloc(*items, *capacity * item_size);
+
+    if (*items == NULL) {
+        fprintf(stderr, "Error malloc frame layout");
+        exit(1);
+    }
+}
+
+static size_t layout_add(frame_layout *layout, const symbol *sym) {
+    size_t slot;
+    if (layout_find(layout, sym, &slot))
+        return slot;
+
+    if (layout->size == layout->capacity)
+        grow((void **)&layout->vars, &layout->capacity, sizeof(symbol *));
+
+    layout->vars[layout->size] = sym;
+    return layout->size++;
+}
+
+static void declare(scope *s, const expr *ident) {
+    (void)layout_add(s->layout, ident->sym);
+}
+
+static void visit_list(scope *s, const expr_list *list, visit_fn *visit) {
+    expr *e = list->head;
+    for (size_t i = 0; i < list->size; ++i, e = e->next) {
+        visit(s, e);
+    }
+}
+
+static void visit_children(scope *s, expr *e, visit_fn *visit) {
+    switch (e->type) {
+        case EXPR_TYPE_PROGRAM:
+        case EXPR_TYPE_LIST_LITERAL:
+        case EXPR_TYPE_BLOCK_EXPRESSION: {
+            visit_list(s, &e->expressions, visit);
+        } break;
+        case EXPR_TYPE_PREFIX_EXPRESSION: {
+            visit(s, e->right);
+        } break;
+        case EXPR_TYPE_INFIX_EXPRESSION: {
+            visit(s, e->left);
+            visit(s, e->right);
+        } break;
+        case EXPR_TYPE_TERNARY_EXPRESSION: {
+            visit(s, e->condition);
+            visit(s, e->consequence);
+            visit(s, e->alternative);
+        } break;
+        case EXPR_TYPE_CALL_EXPRESSION: {
+            visit(s, e->function);
+            visit_list(s, &e->params, visit);
+        } break;
+        case EXPR_TYPE_INDEX_EXPRESSION: {
+            visit(s, e->list);
+            visit(s, e->index);
+        } break;
+        case EXPR_TYPE_CASE_EXPRESSION: {
+            visit_list(s, &e->conditions, visit);
+            visit_list(s, &e->results, visit);
+        } break;
+        default: {
+        }
+    }
+}
+
+// declares the variables an assignment pattern binds, mirroring assign_lhs
+static void declare_targets(scope *s, expr *target) {
+    switch (target->type) {
+        case EXPR_TYPE_IDENTIFIER: {
+            declare(s, target);
+        } break;
+        case EXPR_TYPE_LIST_LITERAL: {
+            visit_list(s, &target->expressions, declare_targets);
+        } break;
+        case EXPR_TYPE_INFIX_EXPRESSION: {
+            if (target->op.type == TOKEN_TYPE_COMMA || target->op.type == TOKEN_TYPE_COLON) {
+                declare_targets(s, target->left);
+                declare_targets(s, target->right);
+            } else {
+                collect(s, target);
+            }
+        } break;
+        default: {
+            collect(s, target);
+        }
+    }
+}
+
+// mirrors eval_func_params
+static void declare_params(scope *s, expr *params) {
+    switch (params->type) {
+        case EXPR_TYPE_IDENTIFIER: {
+            declare(s, params);
+        } break;
+        case EXPR_TYPE_PREFIX_EXPRESSION: {
+            if (params->op.type == TOKEN_TYPE_COLON_COLON &&
+                params->right->type == EXPR_TYPE_IDENTIFIER)
+                declare(s, params->right);
+        } break;
+        case EXPR_TYPE_INFIX_EXPRESSION: {
+            if (params->op.type == TOKEN_TYPE_COMMA) {
+                declare_params(s, params->left);
+                declare_params(s, params->right);
+            }
+        } break;
+        default: {
+        }
+    }
+}
+
+// declares everything a function body assigns to, leaving nested function
+// literals to their own scope. Those and imports may keep the frame alive
+// after the call, so the layout escapes
+static void collect(scope *s, expr *e) {
+    if (e == NULL)
+        return;
+
+    if (is_function_literal(e) || e->type == EXPR_TYPE_IMPORT_EXPRESSION) {
+        s->layout->escapes = true;
+        return;
+    }
+
+    if (is_assignment(e)) {
+        declare_targets(s, e->left);
+        collect(s, e->right);
+        return;
+    }
+
+    visit_children(s, e, collect);
+}
+
+// the slot of sym, a variable of the function depth scopes out of the flat
+// function s, in the captures of s. Functions in between capture it too,
+// so each closure copies it from the frame making it
+static uint32_t capture(scope *s, const symbol *sym, uint32_t depth) {
+    frame_layout *layout = s->layout;
+
+    if (layout->captures == NULL) {
+        layout->captures = (frame_layout *)ba_malloc(&a.expr_alloc, sizeof(frame_layout));
+        *layout->captures = (frame_layout){
+            // closures share the environment holding their captures
+            .escapes = true,
+        };
+    }
+
+    size_t slot;
+    if (layout_find(layout->captures, sym, &slot))
+        return (uint32_t)slot;
+
+    capture_source from;
+    if (depth == 1) {
+        (void)layout_find(s->outer->layout, sym, &slot);
+        from = (capture_source){.slot = (uint32_t)slot};
+    } else {
+        from = (capture_source){
+            .slot = capture(s->outer, sym, depth - 1),
+            .outer = true,
+        };
+    }
+
+    size_t capacity = layout->captures->capacity;
+    slot = layout_add(layout->captures, sym);
+
+    if (layout->captures->capacity != capacity) {
+        layout->capture_from = (capture_source *)realloc(
+            layout->capture_from, layout->captures->capacity * sizeof(capture_source));
+
+        if (layout->capture_from == NULL) {
+            fprintf(stderr, "Error malloc frame layout");
+            exit(1);
+        }
+    }
+
+    layout->capture_from[slot] = from;
+    return (uint32_t)slot;
+}
+
+// a variable of the flat function s is unbound until assigned, and reading
+// it before then finds the enclosing function's variable of that name by
+// name, so that one is captured as well
+static void capture_shadowed(scope *s, const symbol *sym) {
+    uint32_t depth = 1;
+
+    for (scope *cur = s->outer; cur->outer != NULL; cur = cur->outer, ++depth) {
+        size_t slot;
+        if (layout_find(cur->layout, sym, &slot)) {
+            (void)capture(s, sym, depth);
+            return;
+        }
+    }
+}
+
+static void resolve_identifier(scope *s, expr *ident) {
+    size_t slot;
+    uint32_t depth = 0;
+
+    for (scope *cur = s; cur != NULL; cur = cur->outer, ++depth) {
+        if (cur->globals != NULL) {
+            slot = env_declare(cur->globals, ident->sym);
+        } else if (cur->layout == NULL) {
+            return;
+        } else if (!layout_find(cur->layout, ident->sym, &slot)) {
+            continue;
+        }
+
+        ident->layout = cur->layout;
+        ident->depth = depth;
+        ident->slot = (uint32_t)slot;
+
+        if (!s->layout->flat)
+            return;
+
+        if (depth == 0) {
+            capture_shadowed(s, ident->sym);
+            return;
+        }
+
+        // a flat function's frame is made in the environment of its
+        // captures, which is made in the top level
+        if (cur->outer != NULL) {
+            ident->slot = capture(s, ident->sym, depth);
+            ident->layout = s->layout->captures;
+            ident->depth = 1;
+            return;
+        }
+
+        if (s->top_ident_count == s->top_ident_capacity)
+            grow((void **)&s->top_idents, &s->top_ident_capacity, sizeof(expr *));
+
+        s->top_idents[s->top_ident_count++] = ident;
+        ident->depth = 1;
+        return;
+    }
+}
+
+// marks the calls whose value is the value of the function body e, which
+// run in place of the frame making them
+static void mark_tail_calls(expr *e) {
+    switch (e->type) {
+        case EXPR_TYPE_CALL_EXPRESSION: {
+            e->is_tail_call = true;
+        } break;
+        case EXPR_TYPE_BLOCK_EXPRESSION: {
+            if (e->expressions.tail != NULL)
+                mark_tail_calls(e->expressions.tail);
+        } break;
+        case EXPR_TYPE_TERNARY_EXPRESSION: {
+            mark_tail_calls(e->consequence);
+            mark_tail_calls(e->alternative);
+        } break;
+        case EXPR_TYPE_CASE_EXPRESSION: {
+            for (expr *result = e->results.head; result != NULL; result = result->next) {
+                mark_tail_calls(result);
+            }
+        } break;
+        default: {
+        }
+    }
+}
+
+static void find_imports(scope *s, expr *e) {
+    if (e == NULL)
+        return;
+
+    if (e->type == EXPR_TYPE_IMPORT_EXPRESSION) {
+        s->nests_flat = false;
+        return;
+    }
+
+    visit_children(s, e, find_imports);
+}
+
+// moves what the resolver grew to the tree, which it lives as long as
+static void keep_layout(frame_layout *layout) {
+    if (layout->size == 0)
+        return;
+
+    const symbol **vars =
+        (const symbol **)ba_malloc(&a.expr_alloc, layout->size * sizeof(symbol *));
+    memcpy(vars, layout->vars, layout->size * sizeof(symbol *));
+    free(layout->vars);
+
+    layout->vars = vars;
+    layout->capacity = layout->size;
+}
+
+static void resolve_function(scope *s, expr *function_literal) {
+    frame_layout *layout = (frame_layout *)ba_malloc(&a.expr_alloc, sizeof(frame_layout));
+    *layout = (frame_layout){0};
+
+    scope function_scope = {
+        .outer = s,
+        .layout = layout,
+    };
+
+    // the functions in a function of the top level are flat, unless one
+    // of them imports, whose variables are only found by name
+    if (s->outer == NULL) {
+        function_scope.nests_flat = true;
+        find_imports(&function_scope, function_literal->right);
+    } else {
+        layout->flat = s->nests_flat;
+        function_scope.nests_flat = s->nests_flat;
+    }
+
+    declare_params(&function_scope, function_literal->left);
+    collect(&function_scope, function_literal->right);
+
+    resolve(&function_scope, function_literal->left);
+    resolve(&function_scope, function_literal->right);
+
+    if (layout->captures != NULL) {
+        for (size_t i = 0; i < function_scope.top_ident_count; ++i)
+            ++function_scope.top_idents[i]->depth;
+
+        frame_layout *captures = layout->captures;
+        capture_source *from = (capture_source *)ba_malloc(
+            &a.expr_alloc, captures->size * sizeof(capture_source));
+        memcpy(from, layout->capture_from, captures->size * sizeof(capture_source));
+        free(layout->capture_from);
+
+        layout->capture_from = from;
+        keep_layout(captures);
+    }
+
+    free(function_scope.top_idents);
+    keep_layout(layout);
+
+    function_literal->fn_layout = layout;
+
+    mark_tail_calls(function_literal->right);
+}
+
+static void resolve(scope *s, expr *e) {
+    if (e == NULL)
+        return;
+
+    if (e->type == EXPR_TYPE_IDENTIFIER) {
+        resolve_identifier(s, e);
+    } else if (is_function_literal(e)) {
+        resolve_function(s, e);
+    } else {
+        visit_children(s, e, resolve);
+    }
+}
+
+void resolve_program(expr *program, environment *env) {
+    bool is_global = env->outer == NULL;
+
+    scope top = {
+        .layout = is_global ? env->layout : NULL,
+        .globals = is_global ? env : NULL,
+    };
+
+    resolve(&top, program);
+}
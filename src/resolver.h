@@ -0,0 +1,17 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "ast.h"
+#include "environment.h"
+
+// Runs between parsing and evaluation. Every function literal gets a frame
+// layout, and every identifier is pointed at the frame and slot it refers
+// to. A variable is local to a function when the function assigns to it
+// anywhere, reads of it before that fall back to lookups by name.
+//
+// Top level variables get global slots when env is the global environment,
+// otherwise (a file imported inside a function) they are left to lookups
+// by name.
+void resolve_program(expr *program, environment *env);
+
+#endif  // RESOLVER_H
@@ -0,0 +1,15 @@
+#ifndef SLOT_H
+#define SLOT_H
+
+// A slot is where lists and environments keep their values. It has the
+// layout of the first SLOT_SIZE bytes of an object (rc, type and one word
+// of payload): scalars are stored in it directly, anything else as a
+// counted reference to a heap object. Slots are only accessed through
+// slot_obj and the slot_* functions in object.h.
+#define SLOT_SIZE 24
+
+typedef struct {
+    _Alignas(8) unsigned char bytes[SLOT_SIZE];
+} object_slot;
+
+#endif  // SLOT_H
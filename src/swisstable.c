@@ -0,0 +1,180 @@
+#include "swisstable.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xfe)
+
+// load factor, tombstones included, past which the table is rehashed
+#define MAX_LOAD_NUM 7
+#define MAX_LOAD_DEN 8
+
+static inline size_t h1(uint64_t hash) {
+    return (size_t)(hash >> 7);
+}
+
+static inline uint8_t h2(uint64_t hash) {
+    return (uint8_t)(hash & 0x7f);
+}
+
+// bit i is set when control byte i of the group equals byte
+static inline uint32_t group_match(const uint8_t *group, uint8_t byte) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < ST_GROUP_SIZE; ++i)
+        mask |= (uint32_t)(group[i] == byte) << i;
+    return mask;
+#endif
+}
+
+// empty and deleted are the only control bytes with the high bit set
+static inline uint32_t group_match_free(const uint8_t *group) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(ctrl);
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < ST_GROUP_SIZE; ++i)
+        mask |= (uint32_t)(group[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+static void alloc_table(swiss_table *st, size_t capacity) {
+    st->ctrl = (uint8_t *)malloc(capacity);
+    st->items = (unsigned char *)malloc(capacity * st->item_size);
+
+    if (st->ctrl == NULL || st->items == NULL) {
+        fprintf(stderr, "Error malloc swiss table");
+        exit(1);
+    }
+
+    memset(st->ctrl, CTRL_EMPTY, capacity);
+    st->capacity = capacity;
+}
+
+void st_init(swiss_table *st, size_t item_size) {
+    *st = (swiss_table){
+        .item_size = item_size,
+    };
+    alloc_table(st, ST_GROUP_SIZE);
+}
+
+void st_destroy(swiss_table *st) {
+    free(st->ctrl);
+    free(st->items);
+}
+
+// groups are probed in triangular steps, which visits every group of a
+// power of two table
+#define for_each_group(st, hash, group, i)                                  \
+    for (size_t group_mask = (st)->capacity / ST_GROUP_SIZE - 1,            \
+                group = h1(hash) & group_mask, i = 0;                       \
+         ; ++i, group = (group + i) & group_mask)
+
+void *st_find(swiss_table *st, uint64_t hash, const void *key, st_eq_fn *eq) {
+    ++st->lookups;
+
+    for_each_group(st, hash, group, i) {
+        ++st->probes;
+
+        const uint8_t *ctrl = st->ctrl + group * ST_GROUP_SIZE;
+
+        for (uint32_t m = group_match(ctrl, h2(hash)); m != 0; m &= m - 1) {
+            size_t idx = group * ST_GROUP_SIZE + (size_t)__builtin_ctz(m);
+            void *item = st_item(st, idx);
+            if (eq(item, key))
+                return item;
+        }
+
+        if (group_match(ctrl, CTRL_EMPTY) != 0)
+            return NULL;
+    }
+}
+
+// first empty or deleted slot on hash's probe sequence
+static size_t find_free(const swiss_table *st, uint64_t hash) {
+    for_each_group(st, hash, group, i) {
+        uint32_t m = group_match_free(st->ctrl + group * ST_GROUP_SIZE);
+        if (m != 0)
+            return group * ST_GROUP_SIZE + (size_t)__builtin_ctz(m);
+    }
+}
+
+static void rehash(swiss_table *st, size_t capacity, st_hash_fn *item_hash) {
+    uint8_t *old_ctrl = st->ctrl;
+    unsigned char *old_items = st->items;
+    size_t old_capacity = st->capacity;
+
+    alloc_table(st, capacity);
+    st->removed = 0;
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old_ctrl[i] & 0x80)
+            continue;
+
+        const void *item = old_items + i * st->item_size;
+        uint64_t hash = item_hash(item);
+
+        size_t idx = find_free(st, hash);
+        st->ctrl[idx] = h2(hash);
+        memcpy(st_item(st, idx), item, st->item_size);
+    }
+
+    free(old_ctrl);
+    free(old_items);
+}
+
+void *st_insert(swiss_table *st, uint64_t hash, st_hash_fn *item_hash) {
+    if ((st->size + st->removed + 1) * MAX_LOAD_DEN > st->capacity * MAX_LOAD_NUM) {
+        // only grow when live items need the room, otherwise clearing the
+        // tombstones is enough
+        size_t capacity = st->capacity;
+        if ((st->size + 1) * 2 * MAX_LOAD_DEN > capacity * MAX_LOAD_NUM)
+            capacity *= 2;
+
+        rehash(st, capacity, item_hash);
+    }
+
+    size_t idx = find_free(st, hash);
+
+    if (st->ctrl[idx] == CTRL_DELETED)
+        --st->removed;
+
+    st->ctrl[idx] = h2(hash);
+    ++st->size;
+
+    return st_item(st, idx);
+}
+
+void st_erase(swiss_table *st, void *item) {
+    size_t idx = ((unsigned char *)item - st->items) / st->item_size;
+    size_t group = idx / ST_GROUP_SIZE;
+
+    // a lookup stops at a group with an empty slot, so if this group has
+    // one nothing probes past it and the slot can be emptied outright
+    if (group_match(st->ctrl + group * ST_GROUP_SIZE, CTRL_EMPTY) != 0) {
+        st->ctrl[idx] = CTRL_EMPTY;
+    } else {
+        st->ctrl[idx] = CTRL_DELETED;
+        ++st->removed;
+    }
+
+    --st->size;
+}
+
+bool st_is_full(const swiss_table *st, size_t idx) {
+    return !(st->ctrl[idx] & 0x80);
+}
+
+void *st_item(const swiss_table *st, size_t idx) {
+    return st->items + idx * st->item_size;
+}
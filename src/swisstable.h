@@ -0,0 +1,51 @@
+#ifndef SWISS_TABLE_H
+#define SWISS_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ST_GROUP_SIZE 16
+
+// Open addressing table of fixed size items. Every slot has a control byte:
+// empty, deleted, or the low 7 bits of its item's hash. Lookups probe a
+// group of 16 control bytes at a time (one SSE2 compare where available),
+// only comparing keys for slots whose 7 bits match.
+//
+// The table does not know where keys live in an item, callers pass the
+// hash and an equality function. Tombstones count towards the load, and a
+// table that is mostly tombstones is rehashed at the same capacity
+// instead of grown.
+typedef struct {
+    uint8_t *ctrl;
+    unsigned char *items;
+    size_t item_size;
+
+    size_t size;
+    size_t removed;   // tombstones
+    size_t capacity;  // power of two, at least one group
+
+    size_t lookups;
+    size_t probes;  // groups looked at by lookups
+} swiss_table;
+
+typedef uint64_t st_hash_fn(const void *item);
+typedef bool st_eq_fn(const void *item, const void *key);
+
+void st_init(swiss_table *st, size_t item_size);
+void st_destroy(swiss_table *st);
+
+// the item matching key, or NULL
+void *st_find(swiss_table *st, uint64_t hash, const void *key, st_eq_fn *eq);
+
+// room for an item with the given hash, which must not be in the table.
+// The caller fills in the item. item_hash rehashes items when the table
+// grows, which moves them
+void *st_insert(swiss_table *st, uint64_t hash, st_hash_fn *item_hash);
+
+void st_erase(swiss_table *st, void *item);
+
+bool st_is_full(const swiss_table *st, size_t idx);
+void *st_item(const swiss_table *st, size_t idx);
+
+#endif  // SWISS_TABLE_H
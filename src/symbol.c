@@ -0,0 +1,97 @@
+#include "symbol.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "swisstable.h"
+
+static swiss_table symbols;
+static bool symbols_ready = false;
+
+typedef struct {
+    const char *literal;
+    size_t length;
+} symbol_key;
+
+// FNV-1a, finished with the murmur3 mixer so the low bits are usable
+static uint64_t hash_name(const char *literal, size_t length) {
+    uint64_t hash = 14695981039346656037llu;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)literal[i];
+        hash *= 1099511628211llu;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdllu;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53llu;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static uint64_t symbol_hash(const void *item) {
+    return (*(const symbol *const *)item)->hash;
+}
+
+static bool symbol_eq(const void *item, const void *key) {
+    const symbol *sym = *(const symbol *const *)item;
+    const symbol_key *k = (const symbol_key *)key;
+    return sym->length == k->length && memcmp(sym->literal, k->literal, k->length) == 0;
+}
+
+const symbol *intern(const char *literal, size_t length) {
+    if (!symbols_ready) {
+        st_init(&symbols, sizeof(symbol *));
+        symbols_ready = true;
+    }
+
+    uint64_t hash = hash_name(literal, length);
+    symbol_key key = {
+        .literal = literal,
+        .length = length,
+    };
+
+    symbol **found = (symbol **)st_find(&symbols, hash, &key, symbol_eq);
+    if (found != NULL)
+        return *found;
+
+    symbol *sym = (symbol *)malloc(sizeof(symbol) + length);
+    if (sym == NULL) {
+        fprintf(stderr, "Error malloc symbol");
+        exit(1);
+    }
+
+    sym->hash = hash;
+    sym->length = length;
+    memcpy(sym->literal, literal, length);
+
+    *(symbol **)st_insert(&symbols, hash, symbol_hash) = sym;
+
+    return sym;
+}
+
+void symbols_destroy(void) {
+    if (!symbols_ready)
+        return;
+
+    for (size_t i = 0; i < symbols.capacity; ++i) {
+        if (st_is_full(&symbols, i))
+            free(*(symbol **)st_item(&symbols, i));
+    }
+
+    st_destroy(&symbols);
+    symbols_ready = false;
+}
+
+void print_symbols_info(void) {
+    if (!symbols_ready)
+        return;
+
+    printf("\n------\n");
+
+    printf("SYMBOLS\nSIZE: %zu\nCAPACITY: %zu\nPROBES PER LOOKUP: %.2f\n",
+           symbols.size, symbols.capacity,
+           symbols.lookups ? (double)symbols.probes / (double)symbols.lookups : 0.0);
+}
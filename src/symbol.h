@@ -0,0 +1,22 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// An interned name. There is one symbol per distinct name, so names are
+// compared by pointer and hashed once.
+typedef struct {
+    uint64_t hash;
+    size_t length;
+    char literal[];
+} symbol;
+
+const symbol *intern(const char *literal, size_t length);
+
+// frees every symbol, for when nothing refers to them anymore
+void symbols_destroy(void);
+
+void print_symbols_info(void);
+
+#endif  // SYMBOL_H
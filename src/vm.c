@@ -0,0 +1,452 @@
+#include "vm.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+#include "evalstack.h"
+#include "evaluator.h"
+
+extern eval_error eval_err;
+
+typedef struct {
+    const chunk *code;
+    const instr *ip;
+    environment *env;
+
+    object *env_obj;  // released on return, NULL for the frame a run starts with
+    object *base;     // the callee, replaced by the result on return
+} vm_frame;
+
+static size_t reserved;  // bytes of each stack
+
+static object *stack;
+static object *stack_end;
+static object *stack_top;  // next free value
+
+static vm_frame *frames;
+static vm_frame *frames_end;
+static vm_frame *fp;  // current frame, frames[0] is never used
+
+void vm_init(size_t stack_size) {
+    if (stack != NULL)
+        return;
+
+    // the same floor as the eval stack
+    if (stack_size < 2 * EVAL_STACK_RESERVE)
+        stack_size = 2 * EVAL_STACK_RESERVE;
+
+    stack = (object *)mmap(NULL, stack_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    frames = (vm_frame *)mmap(NULL, stack_size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (stack == MAP_FAILED || frames == MAP_FAILED) {
+        fprintf(stderr, "Error mmap vm stack");
+        exit(1);
+    }
+
+    reserved = stack_size;
+
+    stack_end = stack + stack_size / sizeof(object);
+    stack_top = stack;
+
+    frames_end = frames + stack_size / sizeof(vm_frame);
+    fp = frames;
+}
+
+void vm_destroy(void) {
+    if (stack == NULL)
+        return;
+
+    munmap(stack, reserved);
+    munmap(frames, reserved);
+    stack = NULL;
+    frames = NULL;
+}
+
+static void vm_error(const expr *e, const char *msg) {
+    eval_err = (eval_error){
+        .e = e,
+    };
+    snprintf(eval_err.msg, ERROR_MSG_LENGTH, "%s", msg);
+}
+
+static inline object *value_of(object *o) {
+    return o->type == OBJECT_TYPE_LVALUE ? o->ref : o;
+}
+
+// what eval_no_l does to the result of eval
+static inline void to_rvalue(object *o) {
+    if (o->type == OBJECT_TYPE_LVALUE) {
+        copy_obj(o, o->ref);
+        temp_retain(o);
+    }
+}
+
+static inline bool has_room(const chunk *code, const object *top) {
+    return fp + 1 < frames_end && top + code->max_stack <= stack_end;
+}
+
+#define CHECK_VM(res) \
+    if (!(res)) return false
+
+#define INT_BINARY(op)                                          \
+    {                                                           \
+        object *l = value_of(sp - 2), *r = value_of(sp - 1);    \
+        if (l->type != OBJECT_TYPE_INT || r->type != OBJECT_TYPE_INT) \
+            goto infix;                                         \
+        int64_t value = l->int_value op r->int_value;           \
+        --sp;                                                   \
+        sp[-1].type = OBJECT_TYPE_INT;                          \
+        sp[-1].int_value = value;                               \
+    }
+
+// written back before anything that may run more code on the stack
+#define SYNC() (stack_top = sp)
+
+// runs until the frame entry returns
+static bool run(vm_frame *entry, object *result) {
+    const chunk *code = fp->code;
+    const instr *ip = fp->ip;
+    environment *env = fp->env;
+
+    object *sp = fp->base;
+
+    for (;;) {
+        const instr *in = ip++;
+
+        switch ((opcode)in->op) {
+            case OP_CONST: {
+                memcpy(sp++, code->constants + in->b, SLOT_SIZE);
+            } break;
+            case OP_UNIT: {
+                *sp++ = (object){
+                    .type = OBJECT_TYPE_UNIT,
+                };
+            } break;
+            case OP_LOAD_LOCAL: {
+                env_binding *binding = env->slots + in->a;
+                if (binding->is_cell)
+                    binding = cell_binding(binding);
+                if (!binding->is_bound)
+                    goto load;
+
+                sp->type = OBJECT_TYPE_LVALUE;
+                sp->ref = slot_obj(&binding->value);
+                sp->is_const = binding->is_const;
+                ++sp;
+            } break;
+            case OP_LOAD: {
+            load:;
+                const expr *ident = code->exprs[in->b];
+                env_binding *binding = env_resolved(env, ident);
+
+                if (binding != NULL && binding->is_bound) {
+                    sp->type = OBJECT_TYPE_LVALUE;
+                    sp->ref = slot_obj(&binding->value);
+                    sp->is_const = binding->is_const;
+                    ++sp;
+                    break;
+                }
+
+                SYNC();
+                CHECK_VM(eval(ident, env, sp));
+                ++sp;
+            } break;
+            case OP_EVAL: {
+                SYNC();
+                CHECK_VM(eval(code->exprs[in->b], env, sp));
+                ++sp;
+            } break;
+            case OP_POP: {
+                temp_cleanup(--sp);
+            } break;
+            case OP_ASSIGN: {
+                SYNC();
+                CHECK_VM(assign_value(code->exprs[in->b], sp - 1, env, sp - 1));
+            } break;
+            case OP_LIST: {
+                size_t count = in->a;
+                object list = {
+                    .type = OBJECT_TYPE_LIST,
+                };
+
+                ol_reserve(&list.values, count);
+
+                object_slot item;
+                for (object *o = sp - count; o < sp; ++o) {
+                    slot_store(&item, o);
+                    ol_append(&list.values, &item);
+                }
+
+                sp -= count;
+                *sp++ = list;
+            } break;
+            case OP_INDEX: {
+                const expr *index_expr = code->exprs[in->b];
+                object *list = sp - 2, *index = sp - 1;
+
+                CHECK_VM(check_subscriptable(index_expr, list));
+                to_rvalue(index);
+
+                size_t idx;
+                CHECK_VM(check_index(index_expr, list, index, &idx));
+
+                object item;
+                index_read(list, idx, &item);
+
+                --sp;
+                sp[-1] = item;
+            } break;
+            case OP_PREFIX: {
+                to_rvalue(sp - 1);
+                CHECK_VM(eval_prefix_value(code->exprs[in->b], sp - 1, NULL));
+            } break;
+            case OP_ADD: {
+                INT_BINARY(+);
+            } break;
+            case OP_SUB: {
+                INT_BINARY(-);
+            } break;
+            case OP_MUL: {
+                INT_BINARY(*);
+            } break;
+            case OP_DIV: {
+                INT_BINARY(/);
+            } break;
+            case OP_LT: {
+                INT_BINARY(<);
+            } break;
+            case OP_GT: {
+                INT_BINARY(>);
+            } break;
+            case OP_LT_EQ: {
+                INT_BINARY(<=);
+            } break;
+            case OP_GT_EQ: {
+                INT_BINARY(>=);
+            } break;
+            case OP_EQ: {
+                INT_BINARY(==);
+            } break;
+            case OP_NOT_EQ: {
+                INT_BINARY(!=);
+            } break;
+            case OP_INFIX: {
+            infix:;
+                object *left = sp - 2, *right = sp - 1;
+                to_rvalue(left);
+                to_rvalue(right);
+
+                object value;
+                CHECK_VM(eval_infix_values(code->exprs[in->b], left, right, &value));
+
+                --sp;
+                sp[-1] = value;
+            } break;
+            case OP_FUNCTION: {
+                SYNC();
+                CHECK_VM(eval_function_literal(code->exprs[in->b], env, sp));
+                ++sp;
+            } break;
+            case OP_COMPOSE: {
+                object value;
+                CHECK_VM(compose_values(code->exprs[in->b], sp - 2, sp - 1, &value));
+
+                --sp;
+                sp[-1] = value;
+            } break;
+            case OP_CHECK_PIPE: {
+                CHECK_VM(check_pipe(code->exprs[in->b], sp - 1));
+            } break;
+            case OP_BIND: {
+                object value;
+                bind_arg(sp - 2, sp - 1, &value);
+
+                --sp;
+                sp[-1] = value;
+            } break;
+            case OP_JUMP: {
+                ip = code->code + in->b;
+            } break;
+            case OP_JUMP_IF_FALSE: {
+                object *condition = --sp;
+
+                bool truthy = is_truthy(in->a ? condition : value_of(condition));
+                temp_cleanup(condition);
+
+                if (!truthy)
+                    ip = code->code + in->b;
+            } break;
+            case OP_PREPARE_CALL: {
+                const expr *call_expr = code->exprs[in->b];
+                object *func = sp - 1;
+
+                to_rvalue(func);
+
+                if (is_known_call(call_expr, func))
+                    break;
+
+                CHECK_VM(check_call(call_expr, func));
+
+                if (func->kind == FUNCTION_KIND_BUILTIN) {
+                    SYNC();
+
+                    object value;
+                    CHECK_VM(func->builtin_fn(&call_expr->params, call_expr, env, &value));
+
+                    *func = value;
+                    ip = code->code + in->a;
+                    break;
+                }
+
+                // checked again by OP_CALL, the arguments may run this call
+                (void)quicken_call(call_expr, func);
+            } break;
+            case OP_CALL:
+            case OP_TAIL_CALL: {
+                const expr *call_expr = code->exprs[in->b];
+                size_t argc = in->a;
+                object *func = sp - argc - 1;
+
+                SYNC();
+
+                if (func->kind != FUNCTION_KIND_NORMAL) {
+                    object value;
+                    CHECK_VM(apply_function(func, func + 1, argc, call_expr, env, &value));
+                    temp_cleanup(func);
+
+                    *func = value;
+                    sp = func + 1;
+                    break;
+                }
+
+                object *func_env_obj = new_frame(func, env);
+                environment *func_env = &func_env_obj->env;
+
+                const expr *func_param = func->params.head;
+
+                if (is_known_call(call_expr, func)) {
+                    for (object *arg = func; ++arg < sp; func_param = func_param->next) {
+                        CHECK_VM(bind_known_param(func_param, arg, call_expr, func_env));
+                    }
+                } else {
+                    for (object *arg = func; ++arg < sp; func_param = func_param->next) {
+                        CHECK_VM(bind_param(func_param, arg, call_expr, func_env));
+                    }
+                }
+
+                sp = func + 1;
+
+                if (func->code == NULL) {
+                    SYNC();
+
+                    object value;
+                    CHECK_VM(run_body(func, func_env, &value));
+                    finish_call(&value, func_env_obj, func);
+
+                    *func = value;
+                    break;
+                }
+
+                // the callee takes over the frame making the call, unless
+                // that frame belongs to whoever started this run
+                if (in->op == OP_TAIL_CALL && fp->env_obj != NULL) {
+                    rc_dec(fp->env_obj);
+                    temp_cleanup(fp->base);
+
+                    *fp->base = *func;
+                    sp = fp->base + 1;
+
+                    if (!has_room(func->code, sp)) {
+                        stack_overflow_error(call_expr);
+                        return false;
+                    }
+
+                    fp->code = fp->base->code;
+                    fp->ip = fp->code->code;
+                    fp->env = func_env;
+                    fp->env_obj = func_env_obj;
+
+                    code = fp->code;
+                    ip = fp->ip;
+                    env = fp->env;
+                    break;
+                }
+
+                if (!has_room(func->code, sp)) {
+                    stack_overflow_error(call_expr);
+                    return false;
+                }
+
+                fp->ip = ip;
+                ++call_depth;
+
+                *++fp = (vm_frame){
+                    .code = func->code,
+                    .ip = func->code->code,
+                    .env = func_env,
+                    .env_obj = func_env_obj,
+                    .base = func,
+                };
+
+                code = fp->code;
+                ip = fp->ip;
+                env = fp->env;
+            } break;
+            case OP_RETURN: {
+                object *value = sp - 1;
+
+                if (fp == entry) {
+                    *result = *value;
+                    --fp;
+                    return true;
+                }
+
+                finish_call(value, fp->env_obj, fp->base);
+                *fp->base = *value;
+                sp = fp->base + 1;
+
+                --call_depth;
+                --fp;
+                code = fp->code;
+                ip = fp->ip;
+                env = fp->env;
+            } break;
+            default: {
+                vm_error(NULL, "Invalid instruction");
+                return false;
+            }
+        }
+    }
+}
+
+bool vm_run(const chunk *code, environment *env, object *result) {
+    object *saved_top = stack_top;
+    vm_frame *saved_fp = fp;
+
+    if (!has_room(code, stack_top)) {
+        stack_overflow_error(code->exprs != NULL ? code->exprs[0] : NULL);
+        return false;
+    }
+
+    *++fp = (vm_frame){
+        .code = code,
+        .ip = code->code,
+        .env = env,
+        .base = stack_top,
+    };
+
+    bool ok = run(fp, result);
+
+    // calls an error unwinds past no longer count towards the depth
+    if (!ok)
+        call_depth -= (size_t)(fp - saved_fp - 1);
+
+    stack_top = saved_top;
+    fp = saved_fp;
+
+    return ok;
+}
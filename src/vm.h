@@ -0,0 +1,20 @@
+#ifndef VM_H
+#define VM_H
+
+#include "compiler.h"
+#include "object.h"
+
+// Reserves stack_size bytes for values and as many for call frames. Both
+// are reserved up front so pointers into them stay valid while nested
+// runs push more. Does nothing when already done.
+void vm_init(size_t stack_size);
+
+// Runs code in env. Calls to compiled functions push a frame instead of
+// recursing, anything the compiler left to the tree walker is evaluated
+// with eval, which may in turn enter the vm again.
+WARN_UNUSED_RESULT
+bool vm_run(const chunk *code, environment *env, object *result);
+
+void vm_destroy(void);
+
+#endif  // VM_H